@@ -1,4 +1,9 @@
 #include "bn.h"
+#include "fib_table.h"
+
+#if FIB_TABLE_U64_MAX != BN_FIB_U64_MAX
+#error "fib_table.h does not match BN_FIB_U64_MAX"
+#endif
 
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
 #ifndef SWAP
@@ -25,7 +30,7 @@ static int bn_clz(const bn *src)
     for (int i = src->size - 1; i >= 0; i--) {
         if (src->number[i]) {
             // prevent undefined behavior when src = 0
-            cnt += __builtin_clz(src->number[i]);
+            cnt += __builtin_clzll(src->number[i]) - (64 - BN_WSIZE);
             return cnt;
         } else {
             cnt += BN_WSIZE;
@@ -34,48 +39,96 @@ static int bn_clz(const bn *src)
     return cnt;
 }
 
-/* count the digits of most significant bit */
-static int bn_msb(const bn *src)
+/* heap allocations and reallocations done by the bn library */
+unsigned long bn_nr_alloc, bn_nr_realloc;
+
+static void *bn_heap_alloc(size_t size)
 {
-    return src->size * BN_WSIZE - bn_clz(src);
+    bn_nr_alloc++;
+    return malloc(size);
 }
 
-/*
- * output bn to decimal string
- * Note: the returned string should be freed with the free()
- */
-char *bn_to_string(const bn *src)
+static void *bn_heap_realloc(void *p, size_t size)
 {
-    // log10(x) = log2(x) / log2(10) ~= log2(x) / 3.322
-    size_t len = (BN_WSIZE * src->size) / 3 + 2 + src->sign;
-    char *s = (char *) malloc(len);
-    char *p = s;
+    bn_nr_realloc++;
+    return realloc(p, size);
+}
 
-    memset(s, '0', len - 1);
-    s[len - 1] = '\0';
+/* round size up to the alignment of everything carved from an arena */
+#define BN_ARENA_ALIGN(size) (((size) + 7) & ~(size_t) 7)
 
-    /* src.number[0] contains least significant bits */
-    for (int i = src->size - 1; i >= 0; i--) {
-        /* walk through every bit of bn */
-        for (bn_data d = (bn_data) 1 << (BN_WSIZE - 1); d; d >>= 1) {
-            /* binary -> decimal string */
-            int carry = !!(d & src->number[i]);
-            for (int j = len - 2; j >= 0; j--) {
-                s[j] += s[j] - '0' + carry;
-                carry = (s[j] > '9');
-                if (carry)
-                    s[j] -= 10;
-            }
-        }
+/* bns carved per reservation: the result and up to seven temporaries */
+#define BN_ARENA_NR_BN 8
+
+/* heap block owned by arena, linked through its first word */
+static void *bn_arena_spill(bn_arena *arena, size_t size)
+{
+    void **p = bn_heap_alloc(sizeof(void *) + size);
+    if (!p)
+        return NULL;
+    *p = arena->spill;
+    arena->spill = p;
+    return p + 1;
+}
+
+static void *bn_arena_carve(bn_arena *arena, size_t size)
+{
+    size = BN_ARENA_ALIGN(size);
+    if (arena->size - arena->used < size)
+        return bn_arena_spill(arena, size);
+    void *p = arena->base + arena->used;
+    arena->used += size;
+    return p;
+}
+
+/* take n limbs of scratch from arena, or from the heap if arena is NULL */
+static bn_data *bn_scratch_get(bn_arena *arena, size_t n)
+{
+    if (!arena)
+        return bn_heap_alloc(sizeof(bn_data) * n);
+    return bn_arena_carve(arena, sizeof(bn_data) * n);
+}
+
+/* give back scratch taken by bn_scratch_get(), in LIFO order */
+static void bn_scratch_put(bn_arena *arena, bn_data *p)
+{
+    if (!arena) {
+        free(p);
+    } else if ((char *) p >= arena->base &&
+               (char *) p < arena->base + arena->size) {
+        arena->used = (char *) p - arena->base;
+    } else if (arena->spill == (void **) p - 1) {
+        arena->spill = *((void **) p - 1);
+        free((void **) p - 1);
     }
-    // skip leading zero
-    while (p[0] == '0' && p[1] != '\0') {
-        p++;
+}
+
+bn_arena *bn_arena_new(void)
+{
+    bn_arena *arena = bn_heap_alloc(sizeof(bn_arena));
+    if (!arena)
+        return NULL;
+    memset(arena, 0, sizeof(bn_arena));
+    return arena;
+}
+
+void bn_arena_reset(bn_arena *arena)
+{
+    while (arena->spill) {
+        void **p = arena->spill;
+        arena->spill = *p;
+        free(p);
     }
-    if (src->sign)
-        *(--p) = '-';
-    memmove(s, p, strlen(p) + 1);
-    return s;
+    arena->used = 0;
+}
+
+void bn_arena_free(bn_arena *arena)
+{
+    if (!arena)
+        return;
+    bn_arena_reset(arena);
+    free(arena->base);
+    free(arena);
 }
 
 /*
@@ -84,10 +137,10 @@ char *bn_to_string(const bn *src)
  */
 bn *bn_alloc(size_t size)
 {
-    bn *new = (bn *) malloc(sizeof(bn));
+    bn *new = (bn *) bn_heap_alloc(sizeof(bn));
     if (!new)
         return NULL;
-    new->number = (bn_data *) malloc(sizeof(bn_data) * size);
+    new->number = (bn_data *) bn_heap_alloc(sizeof(bn_data) * size);
     if (!new->number) {
         free(new);
         return NULL;
@@ -95,27 +148,89 @@ bn *bn_alloc(size_t size)
     for (int i = 0; i < size; i++)
         new->number[i] = 0;
     new->size = size;
+    new->capacity = size;
+    new->sign = 0;
+    new->arena = NULL;
+    return new;
+}
+
+/*
+ * alloc a bn of the given size from arena, from the heap if arena is NULL
+ * the bn gets room for arena->limbs limbs so it never has to grow
+ */
+bn *bn_alloc_arena(bn_arena *arena, size_t size)
+{
+    if (!arena)
+        return bn_alloc(size);
+    size_t capacity = MAX(size, arena->limbs);
+    bn *new = bn_arena_carve(arena, sizeof(bn));
+    if (!new)
+        return NULL;
+    new->number = bn_arena_carve(arena, sizeof(bn_data) * capacity);
+    if (!new->number)
+        return NULL;
+    memset(new->number, 0, sizeof(bn_data) * size);
+    new->size = size;
+    new->capacity = capacity;
     new->sign = 0;
+    new->arena = arena;
     return new;
 }
 
 /*
  * free entire bn data structure
+ * bns carved from an arena are given back on bn_arena_reset()
  * return 0 on success, -1 on error
  */
 int bn_free(bn *src)
 {
     if (src == NULL)
         return -1;
+    if (src->arena)
+        return 0;
     free(src->number);
     free(src);
     return 0;
 }
 
+/* move the limbs of src to a buffer of capacity limbs */
+static int bn_grow(bn *src, size_t capacity)
+{
+    bn_data *p;
+    if (!src->arena) {
+        p = bn_heap_realloc(src->number, sizeof(bn_data) * capacity);
+        if (!p)  // realloc fails
+            return -1;
+    } else {
+        /* a bn carved from an arena moves to a block spilled to the heap */
+        p = bn_arena_spill(src->arena, sizeof(bn_data) * capacity);
+        if (!p)
+            return -1;
+        memcpy(p, src->number, sizeof(bn_data) * src->size);
+    }
+    src->number = p;
+    src->capacity = capacity;
+    return 0;
+}
+
+/*
+ * make sure src holds at least capacity limbs without reallocating
+ * return 0 on success, -1 on error
+ */
+int bn_reserve(bn *src, size_t capacity)
+{
+    if (!src)
+        return -1;
+    if (capacity <= src->capacity)
+        return 0;
+    return bn_grow(src, capacity);
+}
+
 /*
  * resize bn
  * return 0 on success, -1 on error
  * data lose IS neglected when shinking the size
+ * the buffer never shrinks and at least doubles when it has to grow
  */
 static int bn_resize(bn *src, size_t size)
 {
@@ -125,10 +240,9 @@ static int bn_resize(bn *src, size_t size)
         return 0;
     if (size == 0)  // prevent realloc(0) = free, which will cause problem
         return 1;
-    src->number = realloc(src->number, sizeof(bn_data) * size);
-    if (!src->number) {  // realloc fails
+    if (size > src->capacity &&
+        bn_grow(src, MAX(size, 2 * (size_t) src->capacity)) < 0)
         return -1;
-    }
     if (size > src->size) {
         for (int i = src->size; i < size; i++)
             src->number[i] = 0;
@@ -150,7 +264,10 @@ int bn_cpy(bn *dest, bn *src)
     return 0;
 }
 
-/* swap bn ptr */
+/*
+ * swap bn ptr
+ * a and b should come from the same arena, or both from the heap
+ */
 void bn_swap(bn *a, bn *b)
 {
     bn tmp = *a;
@@ -159,27 +276,49 @@ void bn_swap(bn *a, bn *b)
 }
 
 /* left bit shift on bn (maximun shift 31) */
-void bn_lshift(bn *src, size_t shift, bn *dest)
+void bn_lshift(const bn *src, size_t shift, bn *dest)
 {
     size_t z = bn_clz(src);
     shift %= BN_WSIZE;  // only handle shift within BN_WSIZE bits atm
-    if (!shift)
+    if (!shift) {
+        if (dest != src)
+            bn_cpy(dest, (bn *) src);
         return;
+    }
 
+    /* dest may be src, so take its size and top limb before resizing */
+    int size = src->size;
+    bn_data top = src->number[size - 1] >> (BN_WSIZE - shift);
     if (shift > z) {
-        bn_resize(dest, src->size + 1);
-        dest->number[src->size] =
-            src->number[src->size - 1] >> (BN_WSIZE - shift);
+        bn_resize(dest, size + 1);
+        dest->number[size] = top;
     } else {
-        bn_resize(dest, src->size);
+        bn_resize(dest, size);
     }
 
-    for (int i = src->size - 1; i > 0; i--)
+    /* from the top down, so each limb of src is read before it is written */
+    for (int i = size - 1; i > 0; i--)
         dest->number[i] =
             src->number[i] << shift | src->number[i - 1] >> (BN_WSIZE - shift);
     dest->number[0] = src->number[0] << shift;
 }
 
+/* right bit shift on bn (maximun shift 31) */
+void bn_rshift(bn *src, size_t shift)
+{
+    shift %= BN_WSIZE;  // only handle shift within BN_WSIZE bits atm
+    if (!shift)
+        return;
+
+    for (int i = 0; i < src->size - 1; i++)
+        src->number[i] = src->number[i] >> shift |
+                         src->number[i + 1] << (BN_WSIZE - shift);
+    src->number[src->size - 1] >>= shift;
+
+    if (!src->number[src->size - 1] && src->size > 1)
+        bn_resize(src, src->size - 1);
+}
+
 /*
  * compare length
  * return 1 if |a| > |b|
@@ -203,6 +342,196 @@ int bn_cmp(const bn *a, const bn *b)
     }
 }
 
+/*
+ * r[n] = a[n] + b[n] + carry, and return the carry out
+ * (n > 0, carry is 0 or 1, r may alias a or b)
+ */
+static bn_data _add_nc(bn_data *r,
+                       const bn_data *a,
+                       const bn_data *b,
+                       long n,
+                       bn_data carry)
+{
+#ifdef BN_ASM_X86_64
+    /* a single adc chain, lea and jrcxz leave CF alone */
+    long i = -n;
+    bn_data t;
+    __asm__(
+        "neg %[carry]\n\t" /* CF = carry */
+        "1:\n\t"
+        "mov (%[a], %[i], 8), %[t]\n\t"
+        "adc (%[b], %[i], 8), %[t]\n\t"
+        "mov %[t], (%[r], %[i], 8)\n\t"
+        "lea 1(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n"
+        "2:\n\t"
+        "mov $0, %k[carry]\n\t"
+        "setc %b[carry]"
+        : [carry] "+r"(carry), [t] "=&r"(t), [i] "+c"(i)
+        : [a] "r"(a + n), [b] "r"(b + n), [r] "r"(r + n)
+        : "cc", "memory");
+    return carry;
+#else
+    for (long i = 0; i < n; i++) {
+        bn_data tmp1 = a[i];
+        bn_data tmp2 = b[i];
+        carry = (tmp1 += carry) < carry;
+        carry += (r[i] = tmp1 + tmp2) < tmp2;
+    }
+    return carry;
+#endif
+}
+
+#ifdef BN_ASM_X86_64
+/*
+ * the vector kernels add whole vectors of limbs without carries, then
+ * resolve the carries between lanes with carry lookahead on bit masks:
+ * g has a bit for each lane whose sum wrapped (it generates a carry) and
+ * p one for each lane whose sum is all ones (it passes a carry on), the
+ * two never share a bit; x = (g << 1) + carry + p ripples each carry
+ * through its run of p lanes, so x ^ p marks the lanes that take a carry
+ * in and the bit above the top lane is the carry out
+ */
+
+/* sums of fewer limbs stay on the adc chain */
+#define BN_ADD_SIMD_THRESHOLD 64
+
+/* bit i of index j is limb i of _add_carry_lanes[j] */
+static const bn_data _add_carry_lanes[16][4] __attribute__((aligned(32))) = {
+#define L(x) {(x) >> 0 & 1, (x) >> 1 & 1, (x) >> 2 & 1, (x) >> 3 & 1}
+    L(0), L(1), L(2), L(3), L(4), L(5), L(6), L(7),
+    L(8), L(9), L(10), L(11), L(12), L(13), L(14), L(15),
+#undef L
+};
+
+/* gcc rejects mask register clobbers unless it may use them itself */
+#ifdef __AVX512F__
+#define BN_AVX512_CLOBBERS "k1", "k2",
+#else
+#define BN_AVX512_CLOBBERS
+#endif
+
+/* _add_nc with four limbs per ymm register, n must be a multiple of 4 */
+static bn_data _add_n_avx2(bn_data *r,
+                           const bn_data *a,
+                           const bn_data *b,
+                           long n,
+                           bn_data carry)
+{
+    long i = -n;
+    bn_data g, p;
+    __asm__(
+        "vpcmpeqq %%ymm2, %%ymm2, %%ymm2\n\t" /* all ones */
+        "vpsllq $63, %%ymm2, %%ymm3\n\t"      /* sign bits */
+        "1:\n\t"
+        "vmovdqu (%[a], %[i], 8), %%ymm0\n\t"
+        "vpaddq (%[b], %[i], 8), %%ymm0, %%ymm1\n\t"
+        /* AVX2 lacks unsigned compares, flip the sign bits instead */
+        "vpxor %%ymm3, %%ymm0, %%ymm0\n\t"
+        "vpxor %%ymm3, %%ymm1, %%ymm4\n\t"
+        "vpcmpgtq %%ymm4, %%ymm0, %%ymm0\n\t" /* a > sum */
+        "vpcmpeqq %%ymm2, %%ymm1, %%ymm4\n\t" /* sum = ~0 */
+        "vmovmskpd %%ymm0, %k[g]\n\t"
+        "vmovmskpd %%ymm4, %k[p]\n\t"
+        "lea (%[carry], %[g], 2), %[g]\n\t"
+        "add %[p], %[g]\n\t"
+        "mov %[g], %[carry]\n\t"
+        "shr $4, %[carry]\n\t"
+        "xor %[p], %[g]\n\t"
+        "and $15, %[g]\n\t"
+        "shl $5, %[g]\n\t"
+        "vpaddq (%[lanes], %[g]), %%ymm1, %%ymm1\n\t"
+        "vmovdqu %%ymm1, (%[r], %[i], 8)\n\t"
+        "add $4, %[i]\n\t"
+        "jnz 1b\n\t"
+        "vzeroupper"
+        : [carry] "+r"(carry), [g] "=&r"(g), [p] "=&r"(p), [i] "+r"(i)
+        : [a] "r"(a + n), [b] "r"(b + n), [r] "r"(r + n),
+          [lanes] "r"(_add_carry_lanes)
+        : "cc", "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4");
+    return carry;
+}
+
+/* _add_nc with eight limbs per zmm register, n must be a multiple of 8 */
+static bn_data _add_n_avx512(bn_data *r,
+                             const bn_data *a,
+                             const bn_data *b,
+                             long n,
+                             bn_data carry)
+{
+    long i = -n;
+    bn_data g, p;
+    __asm__(
+        "vpternlogq $0xff, %%zmm2, %%zmm2, %%zmm2\n\t" /* all ones */
+        "1:\n\t"
+        "vmovdqu64 (%[a], %[i], 8), %%zmm0\n\t"
+        "vpaddq (%[b], %[i], 8), %%zmm0, %%zmm1\n\t"
+        "vpcmpltuq %%zmm0, %%zmm1, %%k1\n\t" /* sum < a */
+        "vpcmpeqq %%zmm2, %%zmm1, %%k2\n\t"  /* sum = ~0 */
+        "kmovw %%k1, %k[g]\n\t"
+        "kmovw %%k2, %k[p]\n\t"
+        "lea (%[carry], %[g], 2), %[g]\n\t"
+        "add %[p], %[g]\n\t"
+        "mov %[g], %[carry]\n\t"
+        "shr $8, %[carry]\n\t"
+        "xor %[p], %[g]\n\t"
+        "kmovw %k[g], %%k1\n\t"
+        "vpsubq %%zmm2, %%zmm1, %%zmm1%{%%k1%}\n\t" /* + 1 where masked */
+        "vmovdqu64 %%zmm1, (%[r], %[i], 8)\n\t"
+        "add $8, %[i]\n\t"
+        "jnz 1b\n\t"
+        "vzeroupper"
+        : [carry] "+r"(carry), [g] "=&r"(g), [p] "=&r"(p), [i] "+r"(i)
+        : [a] "r"(a + n), [b] "r"(b + n), [r] "r"(r + n)
+        : BN_AVX512_CLOBBERS "cc", "memory", "xmm0", "xmm1", "xmm2");
+    return carry;
+}
+#endif
+
+/* the _add_n_* picked by bn_init(), NULL for the adc chain alone */
+static bn_data (*_add_n_simd)(bn_data *r,
+                              const bn_data *a,
+                              const bn_data *b,
+                              long n,
+                              bn_data carry);
+
+/* r[n] = a[n] + b[n], and return the carry (n > 0, r may alias a or b) */
+static bn_data _add_n(bn_data *r, const bn_data *a, const bn_data *b, int n)
+{
+    bn_data carry = 0;
+#ifdef BN_ASM_X86_64
+    if (_add_n_simd && n >= BN_ADD_SIMD_THRESHOLD) {
+        /* multiples of 8 limbs suit both vector kernels */
+        long m = n & ~7L;
+        carry = _add_n_simd(r, a, b, m, carry);
+        if (m == n)
+            return carry;
+        r += m;
+        a += m;
+        b += m;
+        n -= m;
+    }
+#endif
+    return _add_nc(r, a, b, n, carry);
+}
+
+/* r[an] = a[an] + b[bn], and return the carry (an >= bn, r may alias a) */
+static bn_data _add_limbs(bn_data *r,
+                          const bn_data *a,
+                          int an,
+                          const bn_data *b,
+                          int bn)
+{
+    bn_data carry = bn ? _add_n(r, a, b, bn) : 0;
+    for (int i = bn; i < an; i++) {
+        bn_data tmp1 = a[i];
+        carry = (tmp1 += carry) < carry;
+        r[i] = tmp1;
+    }
+    return carry;
+}
+
 /* |c| = |a| + |b| */
 static void bn_do_add(const bn *a, const bn *b, bn *c)
 {
@@ -227,19 +556,8 @@ static void bn_do_add(const bn *a, const bn *b, bn *c)
         SWAP(a, b);
 
     bn_resize(c, a->size);
-    bn_data carry = 0;
-    for (int i = 0; i < b->size; i++) {
-        bn_data tmp1 = a->number[i];
-        bn_data tmp2 = b->number[i];
-        carry = (tmp1 += carry) < carry;
-        carry += (c->number[i] = tmp1 + tmp2) < tmp2;
-    }
-    // remaining part if a->size > b->size
-    for (int i = b->size; i < a->size; i++) {
-        bn_data tmp1 = a->number[i];
-        carry = (tmp1 += carry) < carry;
-        c->number[i] = tmp1;
-    }
+    bn_data carry =
+        _add_limbs(c->number, a->number, a->size, b->number, b->size);
     // remaining carry which need new number space
     if (carry) {
         bn_resize(c, a->size + 1);
@@ -321,186 +639,2012 @@ void bn_sub(const bn *a, const bn *b, bn *c)
 }
 
 /* c[size] += a[size] * k, and return the carry */
-static bn_data _mult_partial(const bn_data *a,
-                             bn_data asize,
-                             const bn_data k,
-                             bn_data *c)
+static bn_data _mult_partial_c(const bn_data *a,
+                               bn_data asize,
+                               const bn_data k,
+                               bn_data *c)
 {
     if (k == 0)
         return 0;
 
     bn_data carry = 0;
     for (int i = 0; i < asize; i++) {
-        bn_data high, low;
-        __asm__("mulq %3" : "=a"(low), "=d"(high) : "%0"(a[i]), "rm"(k));
+        bn_data high, low = bn_mul_limb(a[i], k, &high);
         carry = high + ((low += carry) < carry);
         carry += ((c[i] += low) < low);
     }
     return carry;
 }
+
+#ifdef BN_ASM_X86_64
 /*
- * c = a x b
- * Note: work for c == a or c == b
- * using the simple quadratic-time algorithm (long multiplication)
- */
-void bn_mult(const bn *a, const bn *b, bn *c)
-{
-    // max digits = sizeof(a) + sizeof(b))
-    int d = bn_msb(a) + bn_msb(b);
-    d = DIV_ROUNDUP(d, BN_WSIZE) + !d;  // round up, min size = 1
-    bn *tmp;
-    /* make it work properly when c == a or c == b */
-    if (c == a || c == b) {
-        tmp = c;  // save c
-        c = bn_alloc(d);
-    } else {
-        tmp = NULL;
-        bn_resize(c, d);
-    }
+ * c[n] += a[n] * k + carry with mulx, one limb per iteration
+ * the low halves are added on the adcx (CF) chain and the high halves
+ * of the previous limb on the adox (OF) chain, so neither addition waits
+ * for the carry of the other; i counts from -n up to 0 with lea and
+ * jrcxz, which leave both flags alone
+ */
+static bn_data _adx_mul_1(const bn_data *a,
+                          long n,
+                          bn_data k,
+                          bn_data *c,
+                          bn_data carry)
+{
+    long i = -n;
+    bn_data lo, hi;
+    __asm__(
+        "xor %k[lo], %k[lo]\n\t" /* clear CF and OF */
+        "1:\n\t"
+        "mulx (%[a], %[i], 8), %[lo], %[hi]\n\t"
+        "adcx (%[c], %[i], 8), %[lo]\n\t"
+        "adox %[carry], %[lo]\n\t"
+        "mov %[lo], (%[c], %[i], 8)\n\t"
+        "mov %[hi], %[carry]\n\t"
+        "lea 1(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n"
+        "2:\n\t"
+        "mov $0, %k[lo]\n\t"
+        "adcx %[lo], %[carry]\n\t"
+        "adox %[lo], %[carry]"
+        : [carry] "+&r"(carry), [lo] "=&r"(lo), [hi] "=&r"(hi), [i] "+c"(i)
+        : [a] "r"(a + n), [c] "r"(c + n), "d"(k)
+        : "cc", "memory");
+    return carry;
+}
 
-    for (int j = 0; j < b->size; j++) {
-        c->number[a->size + j] =
-            _mult_partial(a->number, a->size, b->number[j], c->number + j);
-    }
+/* _adx_mul_1 unrolled four times, n must be a multiple of 4 */
+static bn_data _adx_mul_4(const bn_data *a,
+                          long n,
+                          bn_data k,
+                          bn_data *c,
+                          bn_data carry)
+{
+    long i = -n;
+    bn_data lo, hi;
+    __asm__(
+        "xor %k[lo], %k[lo]\n\t"
+        "1:\n\t"
+        "mulx (%[a], %[i], 8), %[lo], %[hi]\n\t"
+        "adcx (%[c], %[i], 8), %[lo]\n\t"
+        "adox %[carry], %[lo]\n\t"
+        "mov %[lo], (%[c], %[i], 8)\n\t"
+        "mulx 8(%[a], %[i], 8), %[lo], %[carry]\n\t"
+        "adcx 8(%[c], %[i], 8), %[lo]\n\t"
+        "adox %[hi], %[lo]\n\t"
+        "mov %[lo], 8(%[c], %[i], 8)\n\t"
+        "mulx 16(%[a], %[i], 8), %[lo], %[hi]\n\t"
+        "adcx 16(%[c], %[i], 8), %[lo]\n\t"
+        "adox %[carry], %[lo]\n\t"
+        "mov %[lo], 16(%[c], %[i], 8)\n\t"
+        "mulx 24(%[a], %[i], 8), %[lo], %[carry]\n\t"
+        "adcx 24(%[c], %[i], 8), %[lo]\n\t"
+        "adox %[hi], %[lo]\n\t"
+        "mov %[lo], 24(%[c], %[i], 8)\n\t"
+        "lea 4(%[i]), %[i]\n\t"
+        "jrcxz 2f\n\t"
+        "jmp 1b\n"
+        "2:\n\t"
+        "mov $0, %k[lo]\n\t"
+        "adcx %[lo], %[carry]\n\t"
+        "adox %[lo], %[carry]"
+        : [carry] "+&r"(carry), [lo] "=&r"(lo), [hi] "=&r"(hi), [i] "+c"(i)
+        : [a] "r"(a + n), [c] "r"(c + n), "d"(k)
+        : "cc", "memory");
+    return carry;
+}
 
-    c->sign = a->sign ^ b->sign;
+/* _mult_partial_c with mulx, adcx and adox */
+static bn_data _mult_partial_adx(const bn_data *a,
+                                 bn_data asize,
+                                 const bn_data k,
+                                 bn_data *c)
+{
+    if (k == 0)
+        return 0;
 
-    if (tmp) {
-        bn_cpy(tmp, c);  // restore c
-        bn_free(c);
-    }
+    long head = asize & 3;
+    bn_data carry = 0;
+    if (head)
+        carry = _adx_mul_1(a, head, k, c, carry);
+    if (asize > head)
+        carry = _adx_mul_4(a + head, asize - head, k, c + head, carry);
+    return carry;
 }
+#endif
 
-/* calc n-th Fibonacci number and save into dest */
-void bn_fib_v0(bn *dest, unsigned int n)
+/* the _mult_partial_* picked by bn_init() */
+static bn_data (*_mult_partial)(const bn_data *a,
+                                bn_data asize,
+                                const bn_data k,
+                                bn_data *c) = _mult_partial_c;
+
+unsigned int bn_cpu_features = ~0U;
+
+void bn_init(void)
 {
-    bn_resize(dest, 1);
-    if (n < 2) {  // Fib(0) = 0, Fib(1) = 1
-        dest->number[0] = n;
-        return;
+    unsigned int cpu = 0;
+#ifdef BN_ASM_X86_64
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("bmi2") && __builtin_cpu_supports("adx"))
+        cpu |= BN_CPU_ADX;
+    if (__builtin_cpu_supports("avx2"))
+        cpu |= BN_CPU_AVX2;
+    if (__builtin_cpu_supports("avx512f"))
+        cpu |= BN_CPU_AVX512;
+#endif
+    bn_cpu_features &= cpu;
+
+    _mult_partial = _mult_partial_c;
+#ifdef BN_ASM_X86_64
+    if (bn_cpu_features & BN_CPU_ADX)
+        _mult_partial = _mult_partial_adx;
+#endif
+
+    _add_n_simd = NULL;
+#ifdef BN_ASM_X86_64
+    if (bn_cpu_features & BN_CPU_AVX512)
+        _add_n_simd = _add_n_avx512;
+    else if (bn_cpu_features & BN_CPU_AVX2)
+        _add_n_simd = _add_n_avx2;
+#endif
+}
+
+/* r[an] = a[an] - b[bn], and return the borrow (an >= bn, r may alias a) */
+static bn_data _sub_limbs(bn_data *r,
+                          const bn_data *a,
+                          int an,
+                          const bn_data *b,
+                          int bn)
+{
+    bn_data borrow = 0;
+    for (int i = 0; i < bn; i++) {
+        bn_data tmp1 = a[i];
+        bn_data tmp2 = b[i] + borrow;
+        borrow = (tmp2 < borrow) | (tmp1 < tmp2);
+        r[i] = tmp1 - tmp2;
     }
+    for (int i = bn; i < an; i++) {
+        bn_data tmp1 = a[i];
+        r[i] = tmp1 - borrow;
+        borrow = tmp1 < borrow;
+    }
+    return borrow;
+}
 
-    bn *a = bn_alloc(1);
-    bn *b = bn_alloc(1);
-    dest->number[0] = 1;
+/*
+ * compare a[n] with b[n]
+ * return 1 if a > b, -1 if a < b, 0 if a = b
+ */
+static int _cmp_limbs(const bn_data *a, const bn_data *b, int n)
+{
+    for (int i = n - 1; i >= 0; i--) {
+        if (a[i] != b[i])
+            return a[i] > b[i] ? 1 : -1;
+    }
+    return 0;
+}
 
-    for (unsigned int i = 1; i < n; i++) {
-        bn_swap(b, dest);
-        bn_add(a, b, dest);
-        bn_swap(a, b);
-    }  // dest = result
-    bn_free(a);
-    bn_free(b);
+/* r[an + bn] = a[an] x b[bn] using long multiplication */
+static void _mult_basecase(bn_data *r,
+                           const bn_data *a,
+                           int an,
+                           const bn_data *b,
+                           int bn)
+{
+    memset(r, 0, sizeof(bn_data) * an);
+    for (int j = 0; j < bn; j++)
+        r[an + j] = _mult_partial(a, an, b[j], r + j);
 }
 
-/* calc n-th Fibonacci number and save into dest */
-void bn_fib_v1(bn *dest, unsigned int n)
+/* r[2n] = a[n]^2, each cross product is computed once and doubled */
+static void _sqr_basecase(bn_data *r, const bn_data *a, int n)
 {
-    bn_resize(dest, 1);
-    if (n < 2) {  // Fib(0) = 0, Fib(1) = 1
-        dest->number[0] = n;
-        return;
+    /* r = sum of a[i] * a[j] for i < j */
+    memset(r, 0, sizeof(bn_data) * 2 * n);
+    for (int i = 0; i < n - 1; i++)
+        r[n + i] = _mult_partial(a + i + 1, n - i - 1, a[i], r + 2 * i + 1);
+
+    /* r = 2 * r */
+    bn_data top = 0;
+    for (int i = 0; i < 2 * n; i++) {
+        bn_data tmp = r[i];
+        r[i] = tmp << 1 | top;
+        top = tmp >> (BN_WSIZE - 1);
     }
-    bn *state[2];
-    state[0] = bn_alloc(1);
-    state[1] = bn_alloc(1);
-    state[0]->number[0] = 0;
-    state[1]->number[0] = 1;
 
-    for (unsigned int i = 2; i <= n; ++i)
-        bn_add(state[(i & 1)], state[((i - 1) & 1)], state[(i & 1)]);
+    /* r += a[i]^2 on the diagonal */
+    bn_data carry = 0;
+    for (int i = 0; i < n; i++) {
+        bn_data high, low = bn_mul_limb(a[i], a[i], &high);
+        high += (low += carry) < carry;
+        high += (r[2 * i] += low) < low;
+        carry = (r[2 * i + 1] += high) < high;
+    }
+}
 
-    bn_cpy(dest, state[(n & 1)]);
-    bn_free(state[0]);
-    bn_free(state[1]);
+/*
+ * operands with fewer limbs than this are multiplied with the schoolbook
+ * method, larger ones are split recursively by Karatsuba
+ */
+int bn_karatsuba_threshold = BN_KARATSUBA_THRESHOLD;
+
+/* limbs of workspace that _kara_mult / _kara_sqr may use for n-limb input */
+#define KARA_SCRATCH(n) (4 * (n) + 16 * BN_WSIZE)
+
+static int _kara_cutoff(void)
+{
+    // splitting less than 4 limbs never terminates
+    return bn_karatsuba_threshold < 4 ? 4 : bn_karatsuba_threshold;
 }
 
 /*
- * calc n-th Fibonacci number and save into dest
- * using fast doubling algorithm
+ * add z1 = (a0 + a1)(b0 + b1) - z0 - z2 into the middle of r,
+ * where z0 = r[0, 2m) and z2 = r[2m, 2m + z2n) are already in place
  */
-void bn_fdoubling_v0(bn *dest, unsigned int n)
+static void _kara_merge(bn_data *r,
+                        int rn,
+                        int m,
+                        bn_data *z1,
+                        int z1n,
+                        int z2n)
 {
-    bn_resize(dest, 1);
-    if (n < 2) {  // Fib(0) = 0, Fib(1) = 1
-        dest->number[0] = n;
+    _sub_limbs(z1, z1, z1n, r, 2 * m);
+    _sub_limbs(z1, z1, z1n, r + 2 * m, z2n);
+    while (z1n > 1 && !z1[z1n - 1])
+        z1n--;
+    _add_limbs(r + m, r + m, rn - m, z1, z1n);
+}
+
+/*
+ * r[an + bn] = a[an] x b[bn] with an >= bn
+ * ws should provide at least KARA_SCRATCH(an) limbs
+ */
+static void _kara_mult(bn_data *r,
+                       const bn_data *a,
+                       int an,
+                       const bn_data *b,
+                       int bn,
+                       bn_data *ws)
+{
+    if (bn < _kara_cutoff()) {
+        _mult_basecase(r, a, an, b, bn);
         return;
     }
 
-    bn *f1 = dest;        /* F(k) */
-    bn *f2 = bn_alloc(1); /* F(k+1) */
-    f1->number[0] = 0;
-    f2->number[0] = 1;
-    bn *k1 = bn_alloc(1);
-    bn *k2 = bn_alloc(1);
-
-    /* walk through the digit of n */
-    for (unsigned int i = 1U << (31 - __builtin_clz(n)); i; i >>= 1) {
-        /* F(2k) = F(k) * [ 2 * F(k+1) – F(k) ] */
-        // bn_cpy(k1, f2);     // k1 = F(k+1)
-        bn_lshift(f2, 1, k1);  // k1 = 2* F(k+1)
-        bn_sub(k1, f1, k1);    // k1 = 2 * F(k+1) – F(k)
-        bn_mult(k1, f1, k1);   // k1 = k1 * f1 = F(2k)
-        /* state: k1 = F(2k) ; k2 = X; f1 = F(k); f2 = F(k+1) */
-
-        /* F(2k+1) = F(k)^2 + F(k+1)^2 */
-        bn_mult(f1, f1, f1);  // f1 = F(k)^2
-        bn_mult(f2, f2, f2);  // f2 = F(k+1)^2
-        bn_cpy(k2, f1);       // k2 = F(k)^2
-        bn_add(k2, f2, k2);   // k2 = F(k)^2 + F(k+1)^2  = F(2k+1)
-        /* state: k1 = F(2k) ; k2 = F(2k+1); f1 = X; f2 = X */
-        if (n & i) {
-            bn_cpy(f1, k2);
-            bn_cpy(f2, k1);
-            bn_add(f2, k2, f2);
-            /* state: f1 = F(2k+1); f2 = F(2k+2) */
-        } else {
-            bn_cpy(f1, k1);
-            bn_cpy(f2, k2);
-            /* state: f1 = F(2k); f2 = F(2k+1) */
+    int m = (an + 1) / 2;
+    if (bn <= m) {
+        /* unbalanced: slice a into bn-limb pieces and accumulate */
+        bn_data *t = ws;
+        _kara_mult(r, a, bn, b, bn, ws + 2 * bn);
+        memset(r + 2 * bn, 0, sizeof(bn_data) * (an - bn));
+        for (int i = bn; i < an; i += bn) {
+            int len = an - i < bn ? an - i : bn;
+            _kara_mult(t, b, bn, a + i, len, ws + 2 * bn);
+            _add_limbs(r + i, r + i, an + bn - i, t, bn + len);
         }
+        return;
     }
-    // return f1
-    bn_free(f2);
-    bn_free(k1);
-    bn_free(k2);
+
+    /* a = a1 * B^m + a0, b = b1 * B^m + b0 */
+    int ha = an - m, hb = bn - m;
+    bn_data *sa = ws;
+    bn_data *sb = sa + m + 1;
+    bn_data *z1 = sb + m + 1;
+    bn_data *next = z1 + 2 * (m + 1);
+
+    sa[m] = _add_limbs(sa, a, m, a + m, ha);
+    sb[m] = _add_limbs(sb, b, m, b + m, hb);
+    _kara_mult(z1, sa, m + 1, sb, m + 1, next);
+    _kara_mult(r, a, m, b, m, next);
+    _kara_mult(r + 2 * m, a + m, ha, b + m, hb, next);
+    _kara_merge(r, an + bn, m, z1, 2 * (m + 1), ha + hb);
 }
 
-void bn_fdoubling_v1(bn *dest, unsigned int n)
+/*
+ * r[2n] = a[n]^2
+ * ws should provide at least KARA_SCRATCH(n) limbs
+ */
+static void _kara_sqr(bn_data *r, const bn_data *a, int n, bn_data *ws)
 {
-    bn_resize(dest, 1);
-    if (n < 2) {  // Fib(0) = 0, Fib(1) = 1
-        dest->number[0] = n;
+    if (n < _kara_cutoff()) {
+        _sqr_basecase(r, a, n);
         return;
     }
 
-    bn *f1 = dest;        /* F(k) */
-    bn *f2 = bn_alloc(1); /* F(k+1) */
-    f1->number[0] = 0;
-    f2->number[0] = 1;
-    bn *k = bn_alloc(1);
+    /* a = a1 * B^m + a0, a^2 = a1^2 * B^2m + 2 a0 a1 * B^m + a0^2 */
+    int m = (n + 1) / 2, h = n - m;
+    bn_data *sa = ws;
+    bn_data *z1 = sa + m + 1;
+    bn_data *next = z1 + 2 * (m + 1);
 
-    /* walk through the digit of n */
-    for (unsigned int i = 1U << (31 - __builtin_clz(n)); i; i >>= 1) {
-        /* F(2k) = F(k) * [ 2 * F(k+1) – F(k) ] */
-        bn_lshift(f2, 1, k);  // k = 2* F(k+1)
-        bn_sub(k, f1, k);     // k = 2 * F(k+1) – F(k)
-        bn_mult(k, f1, k);    // k = k1 * f1 = F(2k)
-        /* state: k = F(2k); f1 = F(k); f2 = F(k+1) */
+    sa[m] = _add_limbs(sa, a, m, a + m, h);
+    _kara_sqr(z1, sa, m + 1, next);
+    _kara_sqr(r, a, m, next);
+    _kara_sqr(r + 2 * m, a + m, h, next);
+    _kara_merge(r, 2 * n, m, z1, 2 * (m + 1), 2 * h);
+}
 
-        /* F(2k+1) = F(k)^2 + F(k+1)^2 */
-        bn_mult(f1, f1, f1);  // f1 = F(k)^2
-        bn_mult(f2, f2, f2);  // f2 = F(k+1)^2
-        bn_add(f1, f2, f2);   // f2 = f1^2 + f2^2 = F(2k+1) now
-        bn_swap(f1, k);       // f1 <-> k, f1 = F(2k) now
-        /* state: k = X; f1 = F(2k); f2 = F(2k+1) */
+/*
+ * operands with at least bn_toom3_threshold limbs are split in three by
+ * Toom-Cook, smaller ones are left to Karatsuba
+ */
+int bn_toom3_threshold = BN_TOOM3_THRESHOLD;
 
-        if (n & i) {
-            bn_swap(f1, f2);     // f1 = F(2k+1)
-            bn_add(f1, f2, f2);  // f2 = F(2k+2)
-        }
+/*
+ * limbs of workspace that _toom3_mult / _toom3_sqr may use for n-limb
+ * input, each level takes about 10 / 3 of its input and Karatsuba what
+ * remains below the threshold
+ */
+#define TOOM_SCRATCH(n) (6 * (n) + KARA_SCRATCH(n))
+
+static int _toom3_cutoff(void)
+{
+    // splitting less than 9 limbs may leave an empty top piece
+    return bn_toom3_threshold < 9 ? 9 : bn_toom3_threshold;
+}
+
+/* r[n] = a[n] << 1, and return the bit shifted out (r may alias a) */
+static bn_data _lshift1_limbs(bn_data *r, const bn_data *a, int n)
+{
+    bn_data top = 0;
+    for (int i = 0; i < n; i++) {
+        bn_data tmp = a[i];
+        r[i] = tmp << 1 | top;
+        top = tmp >> (BN_WSIZE - 1);
+    }
+    return top;
+}
+
+/* r[n] = a[n] >> 1 (r may alias a) */
+static void _rshift1_limbs(bn_data *r, const bn_data *a, int n)
+{
+    for (int i = 0; i < n - 1; i++)
+        r[i] = a[i] >> 1 | a[i + 1] << (BN_WSIZE - 1);
+    r[n - 1] = a[n - 1] >> 1;
+}
+
+/*
+ * r[n] = a[n] / 3, a must be a multiple of 3 (r may alias a)
+ * exact division needs no remainder: each quotient limb is the low limb
+ * times the inverse of 3 modulo B, and the high limb of 3 times it is
+ * borrowed from the next limb
+ */
+static void _divexact_by3(bn_data *r, const bn_data *a, int n)
+{
+    const bn_data inv3 = (bn_data) -1 / 3 * 2 + 1; /* 3 * inv3 = 1 mod B */
+    bn_data borrow = 0;
+    for (int i = 0; i < n; i++) {
+        bn_data s = a[i], l = s - borrow, hi;
+        bn_data q = l * inv3;
+        r[i] = q;
+        bn_mul_limb(q, 3, &hi);
+        borrow = hi + (s < borrow);
+    }
+}
+
+static void _toom3_mult(bn_data *r,
+                        const bn_data *a,
+                        int an,
+                        const bn_data *b,
+                        int bn,
+                        bn_data *ws);
+static void _toom3_sqr(bn_data *r, const bn_data *a, int n, bn_data *ws);
+
+/*
+ * r[an + bn] = a[an] x b[bn] with an >= bn, by the method their size
+ * calls for below the NTT
+ */
+static void _mult_rec(bn_data *r,
+                      const bn_data *a,
+                      int an,
+                      const bn_data *b,
+                      int bn,
+                      bn_data *ws)
+{
+    if (bn >= _toom3_cutoff())
+        _toom3_mult(r, a, an, b, bn, ws);
+    else
+        _kara_mult(r, a, an, b, bn, ws);
+}
+
+/* r[2n] = a[n]^2, by the method its size calls for below the NTT */
+static void _sqr_rec(bn_data *r, const bn_data *a, int n, bn_data *ws)
+{
+    if (n >= _toom3_cutoff())
+        _toom3_sqr(r, a, n, ws);
+    else
+        _kara_sqr(r, a, n, ws);
+}
+
+/*
+ * e[n + 1] = a0 + a2 and f[n + 1] = |a0 - a1 + a2| for a = a2 * B^2n +
+ * a1 * B^n + a0, and return the sign of a0 - a1 + a2, then e += a1
+ * e is the value at 1 and f the magnitude of the value at -1
+ */
+static int _toom3_eval_pm1(bn_data *e,
+                           bn_data *f,
+                           const bn_data *a,
+                           int n,
+                           int s)
+{
+    int sign = 0;
+    e[n] = _add_limbs(e, a, n, a + 2 * n, s);
+    if (e[n] || _cmp_limbs(e, a + n, n) >= 0) {
+        f[n] = e[n] - _sub_limbs(f, e, n, a + n, n);
+    } else {
+        _sub_limbs(f, a + n, n, e, n);
+        f[n] = 0;
+        sign = 1;
+    }
+    e[n] += _add_limbs(e, e, n, a + n, n);
+    return sign;
+}
+
+/* e[n + 1] = a0 + 2 a1 + 4 a2, the value at 2 */
+static void _toom3_eval_2(bn_data *e, const bn_data *a, int n, int s)
+{
+    /* Horner's rule: (2 a2 + a1) * 2 + a0 */
+    e[s] = _lshift1_limbs(e, a + 2 * n, s);
+    memset(e + s + 1, 0, sizeof(bn_data) * (n - s));
+    _add_limbs(e, e, n + 1, a + n, n);
+    _lshift1_limbs(e, e, n + 1);
+    _add_limbs(e, e, n + 1, a, n);
+}
+
+/*
+ * recover the coefficients c1, c2 and c3 of the product from its values
+ * w1, wm1 (negative if sign) and w2 at 1, -1 and 2, all L limbs long, and
+ * c0 = r[0, 2n) and c4 = r[4n, 4n + hn) already in place, then add them
+ * into r[rn], whose limbs from 2n to 4n are zero
+ */
+static void _toom3_interpolate(bn_data *r,
+                               int rn,
+                               int n,
+                               int hn,
+                               bn_data *w1,
+                               bn_data *wm1,
+                               int sign,
+                               bn_data *w2,
+                               int L)
+{
+    const bn_data *c0 = r, *c4 = r + 4 * n;
+
+    /* w2 = (w2 - wm1) / 3 = c1 + c2 + 3 c3 + 5 c4 */
+    if (sign)
+        _add_limbs(w2, w2, L, wm1, L);
+    else
+        _sub_limbs(w2, w2, L, wm1, L);
+    _divexact_by3(w2, w2, L);
+    /* wm1 = (w1 - wm1) / 2 = c1 + c3 */
+    if (sign)
+        _add_limbs(wm1, w1, L, wm1, L);
+    else
+        _sub_limbs(wm1, w1, L, wm1, L);
+    _rshift1_limbs(wm1, wm1, L);
+    /* w1 = w1 - c0 = c1 + c2 + c3 + c4 */
+    _sub_limbs(w1, w1, L, c0, 2 * n);
+    /* w2 = (w2 - w1) / 2 - 2 c4 = c3 */
+    _sub_limbs(w2, w2, L, w1, L);
+    _rshift1_limbs(w2, w2, L);
+    _sub_limbs(w2, w2, L, c4, hn);
+    _sub_limbs(w2, w2, L, c4, hn);
+    /* w1 = w1 - wm1 - c4 = c2 */
+    _sub_limbs(w1, w1, L, wm1, L);
+    _sub_limbs(w1, w1, L, c4, hn);
+    /* wm1 = wm1 - w2 = c1 */
+    _sub_limbs(wm1, wm1, L, w2, L);
+
+    /* r += c1 * B^n + c2 * B^2n + c3 * B^3n */
+    bn_data *c[3] = {wm1, w1, w2};
+    for (int i = 0; i < 3; i++) {
+        int off = (i + 1) * n, len = L;
+        while (len > 1 && !c[i][len - 1])
+            len--;
+        _add_limbs(r + off, r + off, rn - off, c[i], len);
+    }
+}
+
+/*
+ * r[an + bn] = a[an] x b[bn] with an >= bn, using Toom-3: a and b are
+ * split in three, evaluated at 0, 1, -1, 2 and infinity, multiplied
+ * pointwise and interpolated back, five products of a third the size
+ * ws should provide at least TOOM_SCRATCH(an) limbs
+ */
+static void _toom3_mult(bn_data *r,
+                        const bn_data *a,
+                        int an,
+                        const bn_data *b,
+                        int bn,
+                        bn_data *ws)
+{
+    int n = (an + 2) / 3;
+    int s = an - 2 * n, t = bn - 2 * n;
+    if (t < 1) {
+        /* unbalanced: slice a into bn-limb pieces and accumulate */
+        bn_data *tmp = ws;
+        _mult_rec(r, a, bn, b, bn, ws + 2 * bn);
+        memset(r + 2 * bn, 0, sizeof(bn_data) * (an - bn));
+        for (int i = bn; i < an; i += bn) {
+            int len = an - i < bn ? an - i : bn;
+            _mult_rec(tmp, b, bn, a + i, len, ws + 2 * bn);
+            _add_limbs(r + i, r + i, an + bn - i, tmp, bn + len);
+        }
+        return;
+    }
+
+    int L = 2 * n + 2;
+    bn_data *ea = ws, *eb = ea + n + 1;
+    bn_data *fa = eb + n + 1, *fb = fa + n + 1;
+    bn_data *w1 = fb + n + 1, *wm1 = w1 + L, *w2 = wm1 + L;
+    bn_data *next = w2 + L;
+
+    /* values at 1 and -1 */
+    int sign = _toom3_eval_pm1(ea, fa, a, n, s);
+    sign ^= _toom3_eval_pm1(eb, fb, b, n, t);
+    _mult_rec(w1, ea, n + 1, eb, n + 1, next);
+    _mult_rec(wm1, fa, n + 1, fb, n + 1, next);
+
+    /* value at 2 */
+    _toom3_eval_2(ea, a, n, s);
+    _toom3_eval_2(eb, b, n, t);
+    _mult_rec(w2, ea, n + 1, eb, n + 1, next);
+
+    /* values at 0 and infinity go straight into place */
+    _mult_rec(r, a, n, b, n, next);
+    if (s >= t)
+        _mult_rec(r + 4 * n, a + 2 * n, s, b + 2 * n, t, next);
+    else
+        _mult_rec(r + 4 * n, b + 2 * n, t, a + 2 * n, s, next);
+    memset(r + 2 * n, 0, sizeof(bn_data) * 2 * n);
+
+    _toom3_interpolate(r, an + bn, n, s + t, w1, wm1, sign, w2, L);
+}
+
+/*
+ * r[2n] = a[n]^2 using Toom-3, as _toom3_mult with five squares
+ * ws should provide at least TOOM_SCRATCH(n) limbs
+ */
+static void _toom3_sqr(bn_data *r, const bn_data *a, int an, bn_data *ws)
+{
+    int n = (an + 2) / 3;
+    int s = an - 2 * n;
+    int L = 2 * n + 2;
+    bn_data *ea = ws, *fa = ea + n + 1;
+    bn_data *w1 = fa + n + 1, *wm1 = w1 + L, *w2 = wm1 + L;
+    bn_data *next = w2 + L;
+
+    _toom3_eval_pm1(ea, fa, a, n, s);
+    _sqr_rec(w1, ea, n + 1, next);
+    _sqr_rec(wm1, fa, n + 1, next);
+
+    _toom3_eval_2(ea, a, n, s);
+    _sqr_rec(w2, ea, n + 1, next);
+
+    _sqr_rec(r, a, n, next);
+    _sqr_rec(r + 4 * n, a + 2 * n, s, next);
+    memset(r + 2 * n, 0, sizeof(bn_data) * 2 * n);
+
+    /* a square is never negative */
+    _toom3_interpolate(r, 2 * an, n, 2 * s, w1, wm1, 0, w2, L);
+}
+
+/*
+ * operands with at least this many limbs are multiplied with a number
+ * theoretic transform, smaller ones by Karatsuba or long multiplication
+ */
+int bn_ntt_threshold = BN_NTT_THRESHOLD;
+
+/* see bn_par_run in the header, one thread and no runner by default */
+void (*bn_par_run)(bn_par_fn fn, void *arg, int n);
+int bn_par_threshold = BN_PAR_THRESHOLD;
+int bn_par_max = 1;
+
+/* whether work on operands of n limbs is handed to bn_par_run */
+static int _par_use(int n)
+{
+    return bn_par_run && bn_par_max > 1 && n >= bn_par_threshold;
+}
+
+#if BN_WSIZE == 64
+/*
+ * number theoretic transform (NTT) multiplication
+ * the limbs are the coefficients of two polynomials, which are convolved
+ * modulo three primes below 2^62 by transforms of power of two length;
+ * their product exceeds 2^183, more than any coefficient of the product
+ * reaches (n * 2^128 for n <= 2^55 points), so the Chinese remainder
+ * theorem recovers the coefficients exactly and adding them up with
+ * carries gives the product
+ */
+
+/* primes c * 2^k + 1 in ascending order, and a primitive root of each */
+static const struct {
+    bn_data p, g;
+} _ntt_primes[3] = {
+    {1945555039024054273ULL, 5}, /* 27 * 2^56 + 1 */
+    {2485986994308513793ULL, 5}, /* 69 * 2^55 + 1 */
+    {4179340454199820289ULL, 3}, /* 29 * 2^57 + 1 */
+};
+
+/*
+ * transforms up to this many points run stage by stage, larger ones do
+ * their outermost stage and recurse into the halves, so that the inner
+ * stages stay in cache
+ */
+#define NTT_BLOCK 1024
+
+/* Montgomery arithmetic modulo p with R = 2^64 */
+struct ntt_mod {
+    bn_data p;
+    bn_data pinv; /* p^-1 mod R */
+    bn_data r1;   /* R mod p */
+    bn_data r2;   /* R^2 mod p */
+};
+
+static void _ntt_mod_init(struct ntt_mod *m, bn_data p)
+{
+    /* p * p = 1 mod 8, and each Newton step doubles the correct bits */
+    bn_data inv = p;
+    for (int i = 0; i < 5; i++)
+        inv *= 2 - p * inv;
+    m->p = p;
+    m->pinv = inv;
+    bn_div_limb(1, 0, p, &m->r1);
+    bn_div_limb(m->r1, 0, p, &m->r2);
+}
+
+/* a * b / R mod p, a * b < p * R must be true */
+static inline bn_data _mont_mul(bn_data a, bn_data b, bn_data p, bn_data pinv)
+{
+    bn_data hi, mhi;
+    bn_data lo = bn_mul_limb(a, b, &hi);
+    /* the low limb of (lo * pinv) * p is lo, so the low limbs cancel */
+    bn_mul_limb(lo * pinv, p, &mhi);
+    return hi < mhi ? hi - mhi + p : hi - mhi;
+}
+
+static inline bn_data _mod_add(bn_data a, bn_data b, bn_data p)
+{
+    bn_data s = a + b;
+    return s >= p ? s - p : s;
+}
+
+static inline bn_data _mod_sub(bn_data a, bn_data b, bn_data p)
+{
+    return a >= b ? a - b : a - b + p;
+}
+
+/* x^e * R mod p, the Montgomery form of x^e (x < p) */
+static bn_data _ntt_pow(bn_data x, bn_data e, const struct ntt_mod *m)
+{
+    bn_data r = m->r1;
+    x = _mont_mul(x, m->r2, m->p, m->pinv);
+    for (; e; e >>= 1) {
+        if (e & 1)
+            r = _mont_mul(r, x, m->p, m->pinv);
+        x = _mont_mul(x, x, m->p, m->pinv);
+    }
+    return r;
+}
+
+/*
+ * roots[h + j] = w^(j * n / 2h) for each stage h = 1, 2, ..., n / 2 and
+ * j < h, the twiddle factors of butterflies h points apart, where w is a
+ * primitive n-th root of unity, all in Montgomery form
+ */
+static void _ntt_roots(bn_data *roots,
+                       size_t n,
+                       bn_data w,
+                       const struct ntt_mod *m)
+{
+    bn_data x = m->r1;
+    for (size_t j = 0; j < n / 2; j++) {
+        roots[n / 2 + j] = x;
+        x = _mont_mul(x, w, m->p, m->pinv);
+    }
+    for (size_t h = n / 4; h >= 1; h /= 2) {
+        for (size_t j = 0; j < h; j++)
+            roots[h + j] = roots[2 * h + 2 * j];
+    }
+}
+
+/* one decimation in frequency stage over x[2h] */
+static void _ntt_dif_stage(bn_data *x,
+                           size_t h,
+                           const bn_data *w,
+                           bn_data p,
+                           bn_data pinv)
+{
+    for (size_t j = 0; j < h; j++) {
+        bn_data u = x[j], v = x[j + h];
+        x[j] = _mod_add(u, v, p);
+        x[j + h] = _mont_mul(_mod_sub(u, v, p), w[j], p, pinv);
+    }
+}
+
+/* one decimation in time stage over x[2h] */
+static void _ntt_dit_stage(bn_data *x,
+                           size_t h,
+                           const bn_data *w,
+                           bn_data p,
+                           bn_data pinv)
+{
+    for (size_t j = 0; j < h; j++) {
+        bn_data u = x[j], v = _mont_mul(x[j + h], w[j], p, pinv);
+        x[j] = _mod_add(u, v, p);
+        x[j + h] = _mod_sub(u, v, p);
+    }
+}
+
+/* forward transform of x[n], the output is in bit-reversed order */
+static void _ntt_dif(bn_data *x,
+                     size_t n,
+                     const bn_data *roots,
+                     bn_data p,
+                     bn_data pinv)
+{
+    if (n > NTT_BLOCK) {
+        _ntt_dif_stage(x, n / 2, roots + n / 2, p, pinv);
+        _ntt_dif(x, n / 2, roots, p, pinv);
+        _ntt_dif(x + n / 2, n / 2, roots, p, pinv);
+        return;
+    }
+    for (size_t h = n / 2; h >= 1; h /= 2) {
+        for (size_t s = 0; s < n; s += 2 * h)
+            _ntt_dif_stage(x + s, h, roots + h, p, pinv);
+    }
+}
+
+/*
+ * inverse transform of x[n] in bit-reversed order, without the 1 / n
+ * factor, roots are those of the inverse root of unity
+ */
+static void _ntt_dit(bn_data *x,
+                     size_t n,
+                     const bn_data *roots,
+                     bn_data p,
+                     bn_data pinv)
+{
+    if (n > NTT_BLOCK) {
+        _ntt_dit(x, n / 2, roots, p, pinv);
+        _ntt_dit(x + n / 2, n / 2, roots, p, pinv);
+        _ntt_dit_stage(x, n / 2, roots + n / 2, p, pinv);
+        return;
+    }
+    for (size_t h = 1; h < n; h *= 2) {
+        for (size_t s = 0; s < n; s += 2 * h)
+            _ntt_dit_stage(x + s, h, roots + h, p, pinv);
+    }
+}
+
+/* x[n] = a[an] mod p, zero padded */
+static void _ntt_load(bn_data *x,
+                      size_t n,
+                      const bn_data *a,
+                      int an,
+                      const struct ntt_mod *m)
+{
+    /* a[i] * (R mod p) / R = a[i] mod p */
+    for (int i = 0; i < an; i++)
+        x[i] = _mont_mul(a[i], m->r1, m->p, m->pinv);
+    memset(x + an, 0, sizeof(bn_data) * (n - an));
+}
+
+/*
+ * r[rn] = sum of c[i] * B^i, where x[0][i], x[1][i] and x[2][i] are the
+ * residues of c[i] modulo the three primes
+ */
+static void _ntt_crt(bn_data *r,
+                     int rn,
+                     bn_data *const x[3],
+                     const struct ntt_mod m[3])
+{
+    const bn_data p1 = m[0].p, p2 = m[1].p, p3 = m[2].p;
+    const bn_data pinv2 = m[1].pinv, pinv3 = m[2].pinv;
+    /* Garner's constants in Montgomery form, inverses by Fermat */
+    const bn_data i12 = _ntt_pow(p1, p2 - 2, &m[1]);
+    const bn_data i13 = _ntt_pow(p1, p3 - 2, &m[2]);
+    const bn_data i23 = _ntt_pow(p2, p3 - 2, &m[2]);
+    const bn_data i123 = _mont_mul(i13, i23, p3, pinv3);
+    const bn_data p13 = _mont_mul(p1, m[2].r2, p3, pinv3);
+    bn_data p12_hi, p12_lo = bn_mul_limb(p1, p2, &p12_hi);
+
+    bn_data acc0 = 0, acc1 = 0;
+    for (int i = 0; i < rn; i++) {
+        /* c = v1 + v2 * p1 + v3 * p1 * p2, v1 < p1, v2 < p2, v3 < p3 */
+        bn_data v1 = x[0][i];
+        bn_data v2 = _mont_mul(_mod_sub(x[1][i], v1, p2), i12, p2, pinv2);
+        bn_data t = _mod_sub(x[2][i], v1, p3);
+        t = _mod_sub(t, _mont_mul(v2, p13, p3, pinv3), p3);
+        bn_data v3 = _mont_mul(t, i123, p3, pinv3);
+
+        bn_data c1, c0 = bn_mul_limb(v2, p1, &c1);
+        c1 += (c0 += v1) < v1;
+        bn_data h0, l0 = bn_mul_limb(v3, p12_lo, &h0);
+        bn_data c2, l1 = bn_mul_limb(v3, p12_hi, &c2);
+        c2 += (h0 += l1) < l1;
+        c1 += (c0 += l0) < l0;
+        c2 += (c1 += h0) < h0;
+
+        /* add c to the carries of the lower coefficients */
+        bn_data carry = (acc0 += c0) < c0;
+        c2 += (acc1 += carry) < carry;
+        c2 += (acc1 += c1) < c1;
+        r[i] = acc0;
+        acc0 = acc1;
+        acc1 = c2;
+    }
+}
+
+/* points of the transforms for an n-limb product */
+static size_t _ntt_size(size_t n)
+{
+    size_t size = 2;
+    while (size < n)
+        size *= 2;
+    return size;
+}
+
+/*
+ * limbs of workspace that _ntt_mult may use for an n-limb product, the
+ * transforms modulo each prime need roots and a buffer of their own when
+ * they run in parallel (par)
+ */
+#define NTT_SCRATCH(n, par) (((par) ? 9 : 5) * _ntt_size(n))
+
+/* whether operands of n limbs and more go through the NTT */
+static int _ntt_use(int n)
+{
+    return n >= bn_ntt_threshold;
+}
+
+/* an NTT multiply, shared by the transforms modulo each prime */
+struct ntt_job {
+    const bn_data *a, *b;
+    int an, bn;
+    size_t n;           /* points */
+    bn_data *x[3];      /* the convolution modulo each prime */
+    bn_data *roots[3];  /* roots, then the transform of b */
+    struct ntt_mod m[3];
+};
+
+/* x[i] = the cyclic convolution of a and b modulo the i-th prime */
+static void _ntt_prime(void *arg, int i)
+{
+    struct ntt_job *job = arg;
+    const size_t n = job->n;
+    const struct ntt_mod *m = &job->m[i];
+    const bn_data p = m->p, pinv = m->pinv;
+    const bn_data g = _ntt_primes[i].g;
+    bn_data *x = job->x[i], *roots = job->roots[i];
+
+    _ntt_roots(roots, n, _ntt_pow(g, (p - 1) / n, m), m);
+    _ntt_load(x, n, job->a, job->an, m);
+    _ntt_dif(x, n, roots, p, pinv);
+    bn_data *v = x;
+    if (job->b) {
+        v = roots + n;
+        _ntt_load(v, n, job->b, job->bn, m);
+        _ntt_dif(v, n, roots, p, pinv);
+    }
+
+    /*
+     * the pointwise products carry a factor of 1 / R and the inverse
+     * transform one of n, multiplying by s = R^2 / n cancels both
+     */
+    bn_data s = _mont_mul(p - (p - 1) / n, m->r2, p, pinv);
+    s = _mont_mul(s, m->r2, p, pinv);
+    for (size_t j = 0; j < n; j++) {
+        bn_data t = _mont_mul(x[j], v[j], p, pinv);
+        x[j] = _mont_mul(t, s, p, pinv);
+    }
+
+    _ntt_roots(roots, n, _ntt_pow(g, p - 1 - (p - 1) / n, m), m);
+    _ntt_dit(x, n, roots, p, pinv);
+}
+
+/*
+ * r[an + bn] = a[an] x b[bn], or a[an]^2 if b is NULL and bn = an, with
+ * the three transforms on bn_par_run if par
+ * ws should provide at least NTT_SCRATCH(an + bn, par) limbs
+ */
+static void _ntt_mult(bn_data *r,
+                      const bn_data *a,
+                      int an,
+                      const bn_data *b,
+                      int bn,
+                      bn_data *ws,
+                      int par)
+{
+    struct ntt_job job = {.a = a, .b = b, .an = an, .bn = bn};
+    size_t n = job.n = _ntt_size(an + bn);
+
+    for (int i = 0; i < 3; i++) {
+        _ntt_mod_init(&job.m[i], _ntt_primes[i].p);
+        job.x[i] = ws + i * n;
+        job.roots[i] = ws + 3 * n + (par ? 2 * i * n : 0);
+    }
+    if (par) {
+        bn_par_run(_ntt_prime, &job, 3);
+    } else {
+        for (int i = 0; i < 3; i++)
+            _ntt_prime(&job, i);
+    }
+    _ntt_crt(r, an + bn, job.x, job.m);
+}
+#else
+/* the NTT works on 64-bit limbs, 32-bit builds stay with Karatsuba */
+#define NTT_SCRATCH(n, par) 0
+
+static int _ntt_use(int n)
+{
+    return 0;
+}
+
+static void _ntt_mult(bn_data *r,
+                      const bn_data *a,
+                      int an,
+                      const bn_data *b,
+                      int bn,
+                      bn_data *ws,
+                      int par)
+{
+}
+#endif
+
+/* drop the leading zero limbs of src, min size = 1 */
+static void bn_trim(bn *src)
+{
+    int d = src->size;
+    while (d > 1 && !src->number[d - 1])
+        d--;
+    bn_resize(src, d);
+}
+
+/*
+ * c = a^2
+ * Note: work for c == a, but a distinct c saves copying the result
+ * the workspace is taken from the arena of c
+ */
+int bn_sqr(const bn *a, bn *c)
+{
+    int d = 2 * a->size;
+    int alias = c == a;
+    int ntt = _ntt_use(a->size);
+    int toom = !ntt && a->size >= _toom3_cutoff();
+    int kara = !ntt && !toom && a->size >= _kara_cutoff();
+    int par = ntt && _par_use(a->size);
+    size_t n = alias ? d : 0;
+    if (ntt)
+        n += NTT_SCRATCH(d, par);
+    else if (toom)
+        n += TOOM_SCRATCH(a->size);
+    else if (kara)
+        n += KARA_SCRATCH(a->size);
+    bn_data *ws = n ? bn_scratch_get(c->arena, n) : NULL;
+    bn_data *r;
+    if (n && !ws)
+        return -1;
+
+    /* make it work properly when c == a: square into the workspace */
+    if (alias) {
+        r = ws;
+    } else if (bn_resize(c, d) < 0) {
+        if (ws)
+            bn_scratch_put(c->arena, ws);
+        return -1;
+    } else {
+        r = c->number;
+    }
+
+    if (ntt)
+        _ntt_mult(r, a->number, a->size, NULL, a->size, ws + (alias ? d : 0),
+                  par);
+    else if (toom)
+        _toom3_sqr(r, a->number, a->size, ws + (alias ? d : 0));
+    else if (kara)
+        _kara_sqr(r, a->number, a->size, ws + (alias ? d : 0));
+    else
+        _sqr_basecase(r, a->number, a->size);
+
+    int rc = 0;
+    if (alias) {
+        rc = bn_resize(c, d);
+        if (!rc)
+            memcpy(c->number, r, sizeof(bn_data) * d);
+    }
+    if (ws)
+        bn_scratch_put(c->arena, ws);
+    if (rc < 0)
+        return -1;
+    c->sign = 0;
+    bn_trim(c);
+    return 0;
+}
+
+/*
+ * c = a x b
+ * Note: work for c == a or c == b
+ * operands below bn_karatsuba_threshold limbs use long multiplication,
+ * larger ones the Karatsuba algorithm, from bn_toom3_threshold limbs on
+ * Toom-3 and from bn_ntt_threshold limbs on the NTT, a == b is handled by
+ * bn_sqr
+ * the workspace is taken from the arena of c
+ */
+int bn_mult(const bn *a, const bn *b, bn *c)
+{
+    if (a == b)
+        return bn_sqr(a, c);
+
+    // max digits = sizeof(a) + sizeof(b)
+    int d = a->size + b->size;
+    int sign = a->sign ^ b->sign;
+    int alias = c == a || c == b;
+    if (a->size < b->size)
+        SWAP(a, b);
+    int ntt = _ntt_use(b->size);
+    int toom = !ntt && b->size >= _toom3_cutoff();
+    int kara = !ntt && !toom && b->size >= _kara_cutoff();
+    int par = ntt && _par_use(b->size);
+    size_t n = alias ? d : 0;
+    if (ntt)
+        n += NTT_SCRATCH(d, par);
+    else if (toom)
+        n += TOOM_SCRATCH(a->size);
+    else if (kara)
+        n += KARA_SCRATCH(a->size);
+    bn_data *ws = n ? bn_scratch_get(c->arena, n) : NULL;
+    bn_data *r;
+    if (n && !ws)
+        return -1;
+
+    /* make it work properly when c == a or c == b: multiply into the
+     * workspace */
+    if (alias) {
+        r = ws;
+    } else if (bn_resize(c, d) < 0) {
+        if (ws)
+            bn_scratch_put(c->arena, ws);
+        return -1;
+    } else {
+        r = c->number;
+    }
+
+    if (ntt)
+        _ntt_mult(r, a->number, a->size, b->number, b->size,
+                  ws + (alias ? d : 0), par);
+    else if (toom)
+        _toom3_mult(r, a->number, a->size, b->number, b->size,
+                    ws + (alias ? d : 0));
+    else if (kara)
+        _kara_mult(r, a->number, a->size, b->number, b->size,
+                   ws + (alias ? d : 0));
+    else
+        _mult_basecase(r, a->number, a->size, b->number, b->size);
+
+    int rc = 0;
+    if (alias) {
+        rc = bn_resize(c, d);
+        if (!rc)
+            memcpy(c->number, r, sizeof(bn_data) * d);
+    }
+    if (ws)
+        bn_scratch_put(c->arena, ws);
+    if (rc < 0)
+        return -1;
+    c->sign = sign;
+    bn_trim(c);
+    return 0;
+}
+
+/*
+ * reset arena and make sure it holds the result and temporaries of
+ * operands up to limbs long
+ * return 0 on success, -1 on error
+ */
+int bn_arena_reserve(bn_arena *arena, size_t limbs)
+{
+    bn_arena_reset(arena);
+    /* a product is sized a->size + b->size limbs before trimming */
+    limbs += 2;
+    size_t scratch = limbs >= (size_t) _toom3_cutoff() ? TOOM_SCRATCH(limbs)
+                                                       : KARA_SCRATCH(limbs);
+    if (_ntt_use(limbs) && NTT_SCRATCH(2 * limbs, _par_use(limbs)) > scratch)
+        scratch = NTT_SCRATCH(2 * limbs, _par_use(limbs));
+    size_t size = BN_ARENA_NR_BN *
+                      (BN_ARENA_ALIGN(sizeof(bn)) + sizeof(bn_data) * limbs) +
+                  sizeof(bn_data) * (limbs + scratch);
+    arena->limbs = limbs;
+    if (size <= arena->size)
+        return 0;
+
+    free(arena->base);
+    bn_nr_alloc++;
+    arena->base = malloc(size);
+    if (!arena->base) {
+        arena->size = 0;
+        return -1;
+    }
+    arena->size = size;
+    return 0;
+}
+
+/* limbs of the largest value bn_fib_* and bn_fdoubling_* handle for F(n) */
+size_t bn_fib_limbs(uint64_t n)
+{
+    /*
+     * F(n + 1) < 2^((n + 1) * log2(phi) + 1), log2(phi) < 711 / 1024,
+     * split at 1024 so that no n up to LLONG_MAX overflows the product
+     */
+    uint64_t m = n + 1;
+    uint64_t bits = (m >> 10) * 711 + ((m & 1023) * 711 >> 10) + 1;
+    return bits / BN_WSIZE + 1;
+}
+
+#if BN_WSIZE == 64
+#define BN_DEC_DIGITS 19
+#define BN_DEC_BASE 10000000000000000000ULL
+#else
+#define BN_DEC_DIGITS 9
+#define BN_DEC_BASE 1000000000U
+#endif
+
+/* values of at least this many limbs are converted by divide and conquer */
+#define BN_TO_STRING_DC_THRESHOLD 128
+
+/* x[n] /= d, and return the remainder */
+static bn_data _div_limb(bn_data *x, int n, bn_data d)
+{
+    bn_data r = 0;
+    for (int i = n - 1; i >= 0; i--)
+        x[i] = bn_div_limb(r, x[i], d, &r);
+    return r;
+}
+
+/*
+ * write x[n] to s as exactly width decimal digits (zero padded),
+ * peeling off BN_DEC_DIGITS digits per pass; x is destroyed
+ */
+static void _to_dec_basecase(bn_data *x, int n, char *s, int width)
+{
+    char *p = s + width;
+    while (n > 0 && p > s) {
+        bn_data r = _div_limb(x, n, BN_DEC_BASE);
+        while (n > 0 && !x[n - 1])
+            n--;
+        for (int i = 0; i < BN_DEC_DIGITS && p > s; i++) {
+            *--p = '0' + r % 10;
+            r /= 10;
+        }
+    }
+    memset(s, '0', p - s);
+}
+
+/* src = src x B^k, -1 if out of memory */
+static int bn_shl_limbs(bn *src, int k)
+{
+    int size = src->size;
+    if (bn_resize(src, size + k) < 0)
+        return -1;
+    memmove(src->number + k, src->number, sizeof(bn_data) * size);
+    memset(src->number, 0, sizeof(bn_data) * k);
+    return 0;
+}
+
+/* src = src / B^k, rounded toward zero */
+static void bn_shr_limbs(bn *src, int k)
+{
+    if (src->size <= k) {
+        bn_resize(src, 1);
+        src->number[0] = 0;
+        src->sign = 0;
+        return;
+    }
+    memmove(src->number, src->number + k,
+            sizeof(bn_data) * (src->size - k));
+    bn_resize(src, src->size - k);
+}
+
+/* alloc a bn of value B^k, NULL if out of memory */
+static bn *bn_alloc_base_pow(int k)
+{
+    bn *new = bn_alloc(k + 1);
+    if (new)
+        new->number[k] = 1;
+    return new;
+}
+
+/*
+ * floor(B^(2s) / p) for p[s] with its top bit set,
+ * by restoring binary long division, NULL if out of memory
+ */
+static bn *_recip_basecase(const bn_data *p, int s)
+{
+    bn *q = bn_alloc(s + 1);
+    bn_data *r = malloc(sizeof(bn_data) * (s + 1));
+    if (!q || !r) {
+        bn_free(q);
+        free(r);
+        return NULL;
+    }
+    memset(r, 0, sizeof(bn_data) * (s + 1));
+
+    for (int bit = 2 * s * BN_WSIZE; bit >= 0; bit--) {
+        /* r = 2r + (next bit of B^(2s)) */
+        bn_data top = bit == 2 * s * BN_WSIZE;
+        for (int i = 0; i <= s; i++) {
+            bn_data tmp = r[i];
+            r[i] = tmp << 1 | top;
+            top = tmp >> (BN_WSIZE - 1);
+        }
+        if (r[s] || _cmp_limbs(r, p, s) >= 0) {
+            r[s] -= _sub_limbs(r, r, s, p, s);
+            q->number[bit / BN_WSIZE] |= (bn_data) 1 << (bit % BN_WSIZE);
+        }
+    }
+    free(r);
+    bn_trim(q);
+    return q;
+}
+
+/*
+ * floor(B^(2s) / p) for p[s] with its top bit set, within a few units,
+ * by one Newton iteration from the reciprocal of the upper limbs of p
+ * NULL if out of memory
+ */
+static bn *_recip(const bn_data *p, int s)
+{
+    if (s <= 4)
+        return _recip_basecase(p, s);
+
+    /* v ~= B^(2h) / p_hi, the upper h limbs of p */
+    int h = s / 2 + 2;
+    bn *v = _recip(p + s - h, h);
+    if (!v)
+        return NULL;
+
+    /*
+     * Newton step on V0 = v x B^(s-h):
+     * V = V0 + v x E / B^(s+h) with E = B^(2s) - p x V0,
+     * only the upper h + 2 limbs of E affect the result
+     */
+    bn pv = {(bn_data *) p, s, s, 0};
+    bn *e = bn_alloc_base_pow(s + h);
+    bn *t = bn_alloc(1);
+    int rc = -1;
+    if (e && t && !bn_mult(&pv, v, t)) {
+        bn_sub(e, t, e);  // e = E / B^(s-h)
+        bn_shr_limbs(e, s - h - 1);
+        if (!bn_mult(v, e, t)) {
+            bn_shr_limbs(t, 3 * h - s + 1);
+            rc = bn_shl_limbs(v, s - h);
+        }
+    }
+    if (!rc)
+        rc = bn_reserve(v, v->size + 1); /* the carry of v + t */
+    if (!rc)
+        bn_add(v, t, v);
+
+    bn_free(e);
+    bn_free(t);
+    if (rc < 0) {
+        bn_free(v);
+        return NULL;
+    }
+    return v;
+}
+
+/* 10^(BN_DEC_DIGITS x 2^k) prepared for Barrett division */
+struct bn_dec_pow {
+    bn *pow;   /* the power itself */
+    bn *norm;  /* pow << shift, with the top bit set */
+    bn *inv;   /* B^(2 x norm->size) / norm, within a few units */
+    int shift;
+};
+
+/* d->norm and d->inv of pow, -1 if out of memory */
+static int _dec_pow_init(struct bn_dec_pow *d, bn *pow)
+{
+    d->pow = pow;
+    d->shift = __builtin_clzll(pow->number[pow->size - 1]) -
+               (64 - BN_WSIZE);
+    d->inv = NULL;
+    d->norm = bn_alloc(1);
+    if (!d->norm || bn_reserve(d->norm, pow->size + 1) < 0)
+        return -1;
+    bn_lshift(pow, d->shift, d->norm);
+    d->inv = _recip(d->norm->number, d->norm->size);
+    return d->inv ? 0 : -1;
+}
+
+/*
+ * q = x / d->pow, r = x % d->pow, requires x < d->pow^2
+ * -1 if out of memory
+ */
+static int _dec_divmod(const bn *x, const struct bn_dec_pow *d, bn *q, bn *r)
+{
+    int s = d->norm->size;
+    bn_data one_limb = 1;
+    bn one = {&one_limb, 1, 1, 0};
+    bn *t = bn_alloc(1);
+    /* room for every step below, none of them can fail after this */
+    if (!t || bn_reserve(q, x->size + 1) < 0 ||
+        bn_reserve(r, x->size + 3) < 0) {
+        bn_free(t);
+        return -1;
+    }
+
+    /* Barrett: q = ((x' / B^(s-1)) x inv) / B^(s+1) is off by a few */
+    bn_lshift(x, d->shift, r);
+    int rc = bn_cpy(t, r);
+    if (!rc) {
+        bn_shr_limbs(t, s - 1);
+        rc = bn_mult(t, d->inv, q);
+    }
+    if (!rc) {
+        bn_shr_limbs(q, s + 1);
+        rc = bn_mult(q, d->norm, t);
+    }
+    if (rc < 0) {
+        bn_free(t);
+        return -1;
+    }
+    bn_sub(r, t, r);
+    while (r->sign) {
+        bn_add(r, d->norm, r);
+        bn_sub(q, &one, q);
+    }
+    while (bn_cmp(r, d->norm) >= 0) {
+        bn_sub(r, d->norm, r);
+        bn_add(q, &one, q);
+    }
+    bn_rshift(r, d->shift);
+    bn_free(t);
+    return 0;
+}
+
+/*
+ * write x < pows[k].pow^2 to s as exactly 2 x BN_DEC_DIGITS x 2^k digits,
+ * splitting it into x / pows[k].pow and x % pows[k].pow recursively
+ * -1 if out of memory
+ */
+static int _to_dec_dc(const bn *x,
+                      int k,
+                      const struct bn_dec_pow *pows,
+                      char *s)
+{
+    int width = 2 * (BN_DEC_DIGITS << k);
+
+    if (k == 0 || x->size < BN_TO_STRING_DC_THRESHOLD) {
+        bn_data *tmp = malloc(sizeof(bn_data) * x->size);
+        if (!tmp)
+            return -1;
+        memcpy(tmp, x->number, sizeof(bn_data) * x->size);
+        _to_dec_basecase(tmp, x->size, s, width);
+        free(tmp);
+        return 0;
+    }
+
+    bn *q = bn_alloc(1);
+    bn *r = bn_alloc(1);
+    int ret = -1;
+    if (q && r && !_dec_divmod(x, &pows[k], q, r) &&
+        !_to_dec_dc(q, k - 1, pows, s))
+        ret = _to_dec_dc(r, k - 1, pows, s + width / 2);
+    bn_free(q);
+    bn_free(r);
+    return ret;
+}
+
+/*
+ * output bn to decimal string, NULL if out of memory
+ * Note: the returned string should be freed with the free()
+ */
+char *bn_to_string(const bn *src)
+{
+    int n = src->size;
+    while (n > 1 && !src->number[n - 1])
+        n--;
+
+    int k = 0, width;
+    char *s;
+
+    if (n < BN_TO_STRING_DC_THRESHOLD) {
+        // log10(x) = log2(x) x log10(2) < log2(x) x 1234 / 4096
+        width = ((n * BN_WSIZE * 1234) >> 12) + 1;
+        s = malloc(width + 2);
+        bn_data *tmp = malloc(sizeof(bn_data) * n);
+        if (!s || !tmp) {
+            free(s);
+            free(tmp);
+            return NULL;
+        }
+        memcpy(tmp, src->number, sizeof(bn_data) * n);
+        _to_dec_basecase(tmp, n, s + 1, width);
+        free(tmp);
+    } else {
+        /*
+         * 10^(BN_DEC_DIGITS x 2^k) until its square exceeds src, pows[k]
+         * has more than 2^(k-1) limbs so k is at most the bit length of n
+         * plus one
+         */
+        int nr = 32 - __builtin_clz(n) + 2;
+        struct bn_dec_pow *pows = calloc(nr, sizeof(*pows));
+        bn *pow = bn_alloc(1);
+        int err = !pows || !pow;
+
+        if (!err) {
+            pow->number[0] = BN_DEC_BASE;
+            err = _dec_pow_init(&pows[0], pow);
+        }
+        while (!err && 2 * (pows[k].pow->size - 1) < n) {
+            pow = bn_alloc(1);
+            if (!pow) {
+                err = -1;
+                break;
+            }
+            if (bn_sqr(pows[k].pow, pow)) {
+                bn_free(pow);
+                err = -1;
+                break;
+            }
+            err = _dec_pow_init(&pows[++k], pow);
+        }
+
+        bn x = {src->number, n, n, 0};
+        width = 2 * (BN_DEC_DIGITS << k);
+        s = err ? NULL : malloc(width + 2);
+        if (s && _to_dec_dc(&x, k, pows, s + 1)) {
+            free(s);
+            s = NULL;
+        }
+
+        for (int i = 0; pows && i < nr; i++) {
+            bn_free(pows[i].pow);
+            bn_free(pows[i].norm);
+            bn_free(pows[i].inv);
+        }
+        if (!pows)
+            bn_free(pow);
+        free(pows);
+        if (!s)
+            return NULL;
+    }
+    s[width + 1] = '\0';
+
+    // skip leading zero
+    char *p = s + 1;
+    while (p[0] == '0' && p[1] != '\0')
+        p++;
+    if (src->sign)
+        *(--p) = '-';
+    memmove(s, p, strlen(p) + 1);
+    return s;
+}
+
+/*
+ * output bn to hexadecimal string, lowercase without a prefix
+ * Note: the returned string should be freed with the free()
+ */
+char *bn_to_hex(const bn *src)
+{
+    static const char digits[] = "0123456789abcdef";
+    int n = src->size;
+    while (n > 1 && !src->number[n - 1])
+        n--;
+
+    /* nibbles of the top limb, then every lower limb in full */
+    int top = 1;
+    while (top < BN_WSIZE / 4 && src->number[n - 1] >> (top * 4))
+        top++;
+    size_t len = (size_t) (n - 1) * (BN_WSIZE / 4) + top + 2;
+    char *s = malloc(len);
+    if (!s)
+        return NULL;
+
+    char *p = s;
+    if (src->sign)
+        *p++ = '-';
+    for (int i = n - 1; i >= 0; i--) {
+        bn_data x = src->number[i];
+        for (int j = (i == n - 1 ? top : BN_WSIZE / 4) - 1; j >= 0; j--)
+            *p++ = digits[(x >> (j * 4)) & 0xf];
+    }
+    *p = '\0';
+    return s;
+}
+
+/* dest = F(n) from fib_table, n <= FIB_TABLE_MAX */
+static void _bn_fib_table(bn *dest, uint64_t n)
+{
+    int size = 128 / BN_WSIZE;
+    bn_resize(dest, size);
+    for (int i = 0; i < size; i++)
+        dest->number[i] = fib_table[n][i * BN_WSIZE / 64] >>
+                          (i * BN_WSIZE % 64);
+    while (size > 1 && !dest->number[size - 1])
+        size--;
+    bn_resize(dest, size);
+    dest->sign = 0;
+}
+
+/*
+ * bits of n below the prefix k that fast doubling starts from, the
+ * longest prefix with F(k + 1) in fib_table
+ */
+static int _fib_table_shift(uint64_t n)
+{
+    int shift = 0;
+    while (n >> shift >= FIB_TABLE_MAX)
+        shift++;
+    return shift;
+}
+
+uint64_t bn_fib_u64(uint64_t n)
+{
+    return fib_table[n][0];
+}
+
+/* calc n-th Fibonacci number and save into dest */
+void bn_fib_v0(bn *dest, uint64_t n)
+{
+    bn_resize(dest, 1);
+    if (n < 2) {  // Fib(0) = 0, Fib(1) = 1
+        dest->number[0] = n;
+        return;
+    }
+
+    bn *a = bn_alloc_arena(dest->arena, 1);
+    bn *b = bn_alloc_arena(dest->arena, 1);
+    size_t limbs = bn_fib_limbs(n);
+    bn_reserve(dest, limbs);
+    bn_reserve(a, limbs);
+    bn_reserve(b, limbs);
+    dest->number[0] = 1;
+
+    for (uint64_t i = 1; i < n; i++) {
+        bn_swap(b, dest);
+        bn_add(a, b, dest);
+        bn_swap(a, b);
+    }  // dest = result
+    bn_free(a);
+    bn_free(b);
+}
+
+/* calc n-th Fibonacci number and save into dest */
+void bn_fib_v1(bn *dest, uint64_t n)
+{
+    bn_resize(dest, 1);
+    if (n < 2) {  // Fib(0) = 0, Fib(1) = 1
+        dest->number[0] = n;
+        return;
+    }
+    bn *state[2];
+    state[0] = bn_alloc_arena(dest->arena, 1);
+    state[1] = bn_alloc_arena(dest->arena, 1);
+    size_t limbs = bn_fib_limbs(n);
+    bn_reserve(dest, limbs);
+    bn_reserve(state[0], limbs);
+    bn_reserve(state[1], limbs);
+    state[0]->number[0] = 0;
+    state[1]->number[0] = 1;
+
+    for (uint64_t i = 2; i <= n; ++i)
+        bn_add(state[(i & 1)], state[((i - 1) & 1)], state[(i & 1)]);
+
+    bn_cpy(dest, state[(n & 1)]);
+    bn_free(state[0]);
+    bn_free(state[1]);
+}
+
+/*
+ * calc n-th Fibonacci number and save into dest
+ * using fast doubling algorithm
+ */
+void bn_fdoubling_v0(bn *dest, uint64_t n)
+{
+    if (n <= FIB_TABLE_MAX) {
+        _bn_fib_table(dest, n);
+        return;
+    }
+
+    int shift = _fib_table_shift(n);
+    bn *f1 = dest;                           /* F(k) */
+    bn *f2 = bn_alloc_arena(dest->arena, 1); /* F(k+1) */
+    bn *k1 = bn_alloc_arena(dest->arena, 1);
+    bn *k2 = bn_alloc_arena(dest->arena, 1);
+    /* a product takes a limb more than its trimmed value */
+    size_t limbs = bn_fib_limbs(n) + 1;
+    bn_reserve(f1, limbs);
+    bn_reserve(f2, limbs);
+    bn_reserve(k1, limbs);
+    bn_reserve(k2, limbs);
+    _bn_fib_table(f1, n >> shift);
+    _bn_fib_table(f2, (n >> shift) + 1);
+
+    /* walk through the digit of n below k */
+    for (uint64_t i = 1ULL << (shift - 1); i; i >>= 1) {
+        /* F(2k) = F(k) * [ 2 * F(k+1) – F(k) ] */
+        // bn_cpy(k1, f2);     // k1 = F(k+1)
+        bn_lshift(f2, 1, k1);  // k1 = 2* F(k+1)
+        bn_sub(k1, f1, k1);    // k1 = 2 * F(k+1) – F(k)
+        bn_mult(k1, f1, k1);   // k1 = k1 * f1 = F(2k)
+        /* state: k1 = F(2k) ; k2 = X; f1 = F(k); f2 = F(k+1) */
+
+        /* F(2k+1) = F(k)^2 + F(k+1)^2 */
+        bn_sqr(f1, k2);       // k2 = F(k)^2
+        bn_sqr(f2, f1);       // f1 = F(k+1)^2
+        bn_add(k2, f1, k2);   // k2 = F(k)^2 + F(k+1)^2  = F(2k+1)
+        /* state: k1 = F(2k) ; k2 = F(2k+1); f1 = X; f2 = X */
+        if (n & i) {
+            bn_cpy(f1, k2);
+            bn_cpy(f2, k1);
+            bn_add(f2, k2, f2);
+            /* state: f1 = F(2k+1); f2 = F(2k+2) */
+        } else {
+            bn_cpy(f1, k1);
+            bn_cpy(f2, k2);
+            /* state: f1 = F(2k); f2 = F(2k+1) */
+        }
     }
     // return f1
     bn_free(f2);
+    bn_free(k1);
+    bn_free(k2);
+}
+
+/* the three products of a fast doubling step */
+struct fd_step {
+    const bn *f1, *f2, *k;
+    bn *t, *sq[2];
+};
+
+static void _fd_step_product(void *arg, int i)
+{
+    struct fd_step *s = arg;
+    if (!i)
+        bn_mult(s->k, s->f1, s->t);
+    else
+        bn_sqr(i == 1 ? s->f1 : s->f2, s->sq[i - 1]);
+}
+
+/*
+ * t = k * f1 and f2 = f1^2 + f2^2 with the products on bn_par_run, the
+ * squares go to heap bns in sq, so that no two threads share an arena
+ * return 0 on success, -1 if sq could not be allocated
+ */
+static int _fd_step_par(bn *f1, bn *f2, const bn *k, bn *t, bn *sq[2],
+                        size_t limbs)
+{
+    for (int i = 0; i < 2; i++) {
+        if (!sq[i])
+            sq[i] = bn_alloc(1);
+        if (bn_reserve(sq[i], limbs) < 0)
+            return -1;
+    }
+    struct fd_step s = {f1, f2, k, t, {sq[0], sq[1]}};
+    bn_par_run(_fd_step_product, &s, 3);
+    bn_add(sq[0], sq[1], f2);
+    return 0;
+}
+
+/*
+ * calc F(n) into f1 and F(n+1) into f2 using fast doubling
+ * temporaries are taken from the arena of f1, f2 should share it
+ */
+void bn_fdoubling_pair(bn *f1, bn *f2, uint64_t n)
+{
+    int shift = _fib_table_shift(n);
+    _bn_fib_table(f1, n >> shift);       /* F(k) */
+    _bn_fib_table(f2, (n >> shift) + 1); /* F(k+1) */
+    if (!shift)
+        return;
+
+    bn *k = bn_alloc_arena(f1->arena, 1);
+    bn *t = bn_alloc_arena(f1->arena, 1);
+    bn *sq[2] = {NULL, NULL}; /* F(k)^2, F(k+1)^2 of parallel steps */
+    /* a product takes a limb more than its trimmed value */
+    size_t limbs = bn_fib_limbs(n) + 1;
+    bn_reserve(f1, limbs);
+    bn_reserve(f2, limbs);
+    bn_reserve(k, limbs);
+    bn_reserve(t, limbs);
+
+    /* walk through the digit of n below k */
+    for (uint64_t i = 1ULL << (shift - 1); i; i >>= 1) {
+        /* F(2k) = F(k) * [ 2 * F(k+1) – F(k) ] */
+        bn_lshift(f2, 1, k);  // k = 2* F(k+1)
+        bn_sub(k, f1, k);     // k = 2 * F(k+1) – F(k)
+        /* the products below on other CPUs as well if they are large */
+        if (!_par_use(f1->size) || _fd_step_par(f1, f2, k, t, sq, limbs)) {
+            bn_mult(k, f1, t);  // t = k * f1 = F(2k)
+            /* state: t = F(2k); f1 = F(k); f2 = F(k+1) */
+
+            /* F(2k+1) = F(k)^2 + F(k+1)^2 */
+            bn_sqr(f1, k);      // k = F(k)^2
+            bn_sqr(f2, f1);     // f1 = F(k+1)^2
+            bn_add(k, f1, f2);  // f2 = F(k)^2 + F(k+1)^2 = F(2k+1) now
+        }
+        bn_swap(f1, t);       // f1 <-> t, f1 = F(2k) now
+        /* state: k = X; t = X; f1 = F(2k); f2 = F(2k+1) */
+
+        if (n & i) {
+            bn_swap(f1, f2);     // f1 = F(2k+1)
+            bn_add(f1, f2, f2);  // f2 = F(2k+2)
+        }
+    }
     bn_free(k);
-}
\ No newline at end of file
+    bn_free(t);
+    bn_free(sq[0]);
+    bn_free(sq[1]);
+}
+
+void bn_fdoubling_v1(bn *dest, uint64_t n)
+{
+    if (n <= FIB_TABLE_MAX) {
+        _bn_fib_table(dest, n);
+        return;
+    }
+
+    bn *f2 = bn_alloc_arena(dest->arena, 1); /* F(n+1) */
+    bn_fdoubling_pair(dest, f2, n);
+    bn_free(f2);
+}
+
+/*
+ * calc F(n) into dest by powers of the Q-matrix: [[1, 1], [1, 0]]^k is
+ * [[F(k+1), F(k)], [F(k), F(k-1)]], symmetric, so a square takes three
+ * squares and a product
+ */
+void bn_fib_qmatrix(bn *dest, uint64_t n)
+{
+    if (n <= FIB_TABLE_MAX) {
+        _bn_fib_table(dest, n);
+        return;
+    }
+
+    int shift = _fib_table_shift(n);
+    bn *a = bn_alloc_arena(dest->arena, 1); /* F(k+1) */
+    bn *b = dest;                           /* F(k) */
+    bn *c = bn_alloc_arena(dest->arena, 1); /* F(k-1) */
+    bn *sa = bn_alloc_arena(dest->arena, 1);
+    bn *sb = bn_alloc_arena(dest->arena, 1);
+    bn *sc = bn_alloc_arena(dest->arena, 1);
+    bn *t = bn_alloc_arena(dest->arena, 1);
+    /* a product takes a limb more than its trimmed value */
+    size_t limbs = bn_fib_limbs(n) + 1;
+    bn_reserve(a, limbs);
+    bn_reserve(b, limbs);
+    bn_reserve(c, limbs);
+    bn_reserve(sa, limbs);
+    bn_reserve(sb, limbs);
+    bn_reserve(sc, limbs);
+    bn_reserve(t, limbs);
+    _bn_fib_table(a, (n >> shift) + 1); /* Q^k */
+    _bn_fib_table(b, n >> shift);
+    _bn_fib_table(c, (n >> shift) - 1);
+
+    /* walk through the digit of n below k */
+    for (uint64_t i = 1ULL << (shift - 1); i; i >>= 1) {
+        /* Q^2k = [[a^2 + b^2, b(a + c)], [b(a + c), b^2 + c^2]] */
+        bn_sqr(a, sa);
+        bn_sqr(b, sb);
+        bn_sqr(c, sc);
+        bn_add(a, c, t);
+        bn_mult(b, t, b);  // b = F(2k)
+        bn_add(sa, sb, a);  // a = F(2k+1)
+        bn_add(sb, sc, c);  // c = F(2k-1)
+
+        if (n & i) {
+            /* Q^(2k+1) = Q^2k * Q = [[a + b, a], [a, b]] */
+            bn_swap(b, c);  // c = F(2k)
+            bn_add(a, c, b);  // b = F(2k+2)
+            bn_swap(a, b);  // a = F(2k+2), b = F(2k+1)
+        }
+    }
+    bn_free(a);
+    bn_free(c);
+    bn_free(sa);
+    bn_free(sb);
+    bn_free(sc);
+    bn_free(t);
+}
+
+/* x += d, for the small constants of the Lucas identities */
+static void _bn_add_si(bn *x, int d)
+{
+    bn_data v = d < 0 ? -d : d;
+    bn c = {.number = &v, .size = 1, .capacity = 1, .sign = d < 0};
+    bn_add(x, &c, x);
+}
+
+/* x /= d, d dividing x */
+static void _bn_divexact_limb(bn *x, bn_data d)
+{
+    _div_limb(x->number, x->size, d);
+    if (!x->number[x->size - 1] && x->size > 1)
+        bn_resize(x, x->size - 1);
+}
+
+/*
+ * calc F(n) into dest by doubling F(k) and the Lucas number L(k) with
+ * S = L(k)^2 and T = (F(k) + L(k))^2, using 5F(k)^2 = L(k)^2 - 4(-1)^k:
+ *   F(2k) = F(k)L(k) = (T - S - (S - 4(-1)^k) / 5) / 2
+ *   L(2k) = S - 2(-1)^k
+ * and F(2k+1) = (F(2k) + L(2k)) / 2, L(2k+1) = (5F(2k) + L(2k)) / 2
+ * two squares per bit of n where fast doubling takes a product and two
+ * squares, the divisions are linear
+ */
+void bn_fib_lucas(bn *dest, uint64_t n)
+{
+    if (n <= FIB_TABLE_MAX) {
+        _bn_fib_table(dest, n);
+        return;
+    }
+
+    int shift = _fib_table_shift(n);
+    bn *f = dest;                           /* F(k) */
+    bn *l = bn_alloc_arena(dest->arena, 1); /* L(k) */
+    bn *s = bn_alloc_arena(dest->arena, 1);
+    bn *t = bn_alloc_arena(dest->arena, 1);
+    bn *u = bn_alloc_arena(dest->arena, 1);
+    /* L(n) < 3F(n) for n > 1, and a product takes a limb more */
+    size_t limbs = bn_fib_limbs(n) + 2;
+    bn_reserve(f, limbs);
+    bn_reserve(l, limbs);
+    bn_reserve(s, limbs);
+    bn_reserve(t, limbs);
+    bn_reserve(u, limbs);
+    _bn_fib_table(f, n >> shift);
+    _bn_fib_table(l, (n >> shift) + 1);
+    bn_lshift(l, 1, l);
+    bn_sub(l, f, l); /* L(k) = 2 * F(k+1) - F(k) */
+    int odd = n >> shift & 1; /* k & 1 */
+
+    /* walk through the digit of n below k */
+    for (uint64_t i = 1ULL << (shift - 1); i; i >>= 1) {
+        int sign = odd ? -1 : 1; /* (-1)^k */
+        bn_add(f, l, u);
+        bn_sqr(u, t);  // t = (F(k) + L(k))^2
+        bn_sqr(l, s);  // s = L(k)^2
+        bn_cpy(u, s);
+        _bn_add_si(u, -4 * sign);
+        _bn_divexact_limb(u, 5);  // u = F(k)^2
+        bn_sub(t, s, t);
+        bn_sub(t, u, t);
+        bn_rshift(t, 1);  // t = F(2k)
+        _bn_add_si(s, -2 * sign);  // s = L(2k)
+        bn_swap(f, t);
+        bn_swap(l, s);
+        odd = 0;
+
+        if (n & i) {
+            bn_lshift(f, 2, u);
+            bn_add(u, f, u);  // u = 5F(2k)
+            bn_add(f, l, f);
+            bn_rshift(f, 1);  // f = F(2k+1)
+            bn_add(u, l, l);
+            bn_rshift(l, 1);  // l = L(2k+1)
+            odd = 1;
+        }
+    }
+    bn_free(l);
+    bn_free(s);
+    bn_free(t);
+    bn_free(u);
+}
+
+/*
+ * calc F(n) into dest by fast doubling on F(k) and F(k-1), whose squares
+ * give the next pair without a product:
+ *   F(2k+1) = 4F(k)^2 - F(k-1)^2 + 2(-1)^k
+ *   F(2k-1) = F(k)^2 + F(k-1)^2
+ *   F(2k) = F(2k+1) - F(2k-1)
+ * the last step only computes F(n), with a single product:
+ *   F(2k) = F(k) * [ F(k) + 2 * F(k-1) ]
+ *   F(2k+1) = [ 2 * F(k) + F(k-1) ] * [ 2 * F(k) - F(k-1) ] + 2(-1)^k
+ */
+void bn_fdoubling_v2(bn *dest, uint64_t n)
+{
+    if (n <= FIB_TABLE_MAX) {
+        _bn_fib_table(dest, n);
+        return;
+    }
+
+    int shift = _fib_table_shift(n);
+    bn *f = dest;                           /* F(k) */
+    bn *g = bn_alloc_arena(dest->arena, 1); /* F(k-1) */
+    bn *s = bn_alloc_arena(dest->arena, 1);
+    bn *t = bn_alloc_arena(dest->arena, 1);
+    /* a product takes a limb more than its trimmed value */
+    size_t limbs = bn_fib_limbs(n) + 1;
+    bn_reserve(f, limbs);
+    bn_reserve(g, limbs);
+    bn_reserve(s, limbs);
+    bn_reserve(t, limbs);
+    _bn_fib_table(f, n >> shift);
+    _bn_fib_table(g, (n >> shift) - 1);
+    int odd = n >> shift & 1; /* k & 1 */
+
+    /* walk through the digit of n between k and the last one */
+    for (uint64_t i = 1ULL << (shift - 1); i > 1; i >>= 1) {
+        bn_sqr(f, s);  // s = F(k)^2
+        bn_sqr(g, t);  // t = F(k-1)^2
+        bn_add(s, t, g);  // g = F(2k-1)
+        bn_lshift(s, 2, s);  // s = 4 * F(k)^2
+        bn_sub(s, t, s);  // s = 4 * F(k)^2 - F(k-1)^2
+        _bn_add_si(s, odd ? -2 : 2);  // s = F(2k+1)
+        bn_sub(s, g, f);  // f = F(2k)
+        /* state: s = F(2k+1); f = F(2k); g = F(2k-1) */
+
+        odd = !!(n & i);
+        if (odd) {
+            bn_swap(f, g);  // g = F(2k)
+            bn_swap(f, s);  // f = F(2k+1)
+        }
+    }
+
+    if (n & 1) {
+        bn_lshift(f, 1, s);  // s = 2 * F(k)
+        bn_add(s, g, t);  // t = 2 * F(k) + F(k-1)
+        bn_sub(s, g, s);  // s = 2 * F(k) - F(k-1)
+        bn_mult(t, s, f);
+        _bn_add_si(f, odd ? -2 : 2);  // f = F(2k+1)
+    } else {
+        bn_lshift(g, 1, s);  // s = 2 * F(k-1)
+        bn_add(s, f, s);  // s = F(k) + 2 * F(k-1)
+        bn_mult(f, s, t);
+        bn_swap(f, t);  // f = F(2k)
+    }
+    bn_free(g);
+    bn_free(s);
+    bn_free(t);
+}
+
+/*
+ * dest = F(k + d) from fk = F(k) and fk1 = F(k + 1) using the addition
+ * formula F(k + d) = F(k + 1) * F(d) + F(k) * F(d - 1)
+ * Note: dest must not be fk or fk1
+ */
+void bn_fib_resume(bn *dest, const bn *fk, const bn *fk1, uint64_t d)
+{
+    if (!d) {
+        bn_cpy(dest, (bn *) fk);
+        return;
+    }
+
+    bn *a = bn_alloc_arena(dest->arena, 1); /* F(d-1) */
+    bn *b = bn_alloc_arena(dest->arena, 1); /* F(d) */
+    bn *t = bn_alloc_arena(dest->arena, 1);
+    bn_fdoubling_pair(a, b, d - 1);
+    bn_mult(fk1, b, t);    // t = F(k+1) * F(d)
+    bn_mult(fk, a, dest);  // dest = F(k) * F(d-1)
+    bn_add(dest, t, dest);
+    bn_free(a);
+    bn_free(b);
+    bn_free(t);
+}
+
+const struct bn_fib_algo bn_fib_algos[FIB_ALGO_NR] = {
+    [FIB_ALGO_ADD] = {"add", bn_fib_v1},
+    [FIB_ALGO_FDOUBLING_V0] = {"fdoubling_v0", bn_fdoubling_v0},
+    [FIB_ALGO_FDOUBLING] = {"fdoubling", bn_fdoubling_v1},
+    [FIB_ALGO_DEC] = {"dec", NULL},
+    [FIB_ALGO_CKPT] = {"ckpt", NULL},
+    [FIB_ALGO_STREAM] = {"stream", NULL},
+    [FIB_ALGO_QMATRIX] = {"qmatrix", bn_fib_qmatrix},
+    [FIB_ALGO_LUCAS] = {"lucas", bn_fib_lucas},
+    [FIB_ALGO_ADD_V0] = {"add_v0", bn_fib_v0},
+    [FIB_ALGO_FDOUBLING_V2] = {"fdoubling_v2", bn_fdoubling_v2},
+    [FIB_ALGO_U64_ADD] = {"u64_add", NULL},
+    [FIB_ALGO_U64_FDOUBLING] = {"u64_fdoubling", NULL},
+};
+
+int bn_fib_algo_find(const char *name)
+{
+    for (int i = 0; i < FIB_ALGO_NR; i++) {
+        if (bn_fib_algos[i].name && !strcmp(bn_fib_algos[i].name, name))
+            return i;
+    }
+    return -1;
+}
@@ -0,0 +1,355 @@
+#include <linux/kernel.h>
+#include <linux/mm.h>
+
+#include "bn_dec_kernel.h"
+
+#ifndef SWAP
+#define SWAP(x, y)           \
+    do {                     \
+        typeof(x) __tmp = x; \
+        x = y;               \
+        y = __tmp;           \
+    } while (0)
+#endif
+
+/*
+ * alloc a bn_dec structure with the given size
+ * the value is initialized to 0
+ */
+bn_dec *bn_dec_alloc(size_t size)
+{
+    bn_dec *new = kvmalloc(sizeof(bn_dec), GFP_KERNEL);
+    if (!new)
+        return NULL;
+    new->number = kvmalloc(sizeof(bn_data) * size, GFP_KERNEL);
+    if (!new->number) {
+        kvfree(new);
+        return NULL;
+    }
+    memset(new->number, 0, sizeof(bn_data) * size);
+    new->size = size;
+    new->capacity = size;
+    return new;
+}
+
+/*
+ * free entire bn_dec data structure
+ * return 0 on success, -1 on error
+ */
+int bn_dec_free(bn_dec *src)
+{
+    if (src == NULL)
+        return -1;
+    kvfree(src->number);
+    kvfree(src);
+    return 0;
+}
+
+/*
+ * resize bn_dec, new limbs are zeroed
+ * return 0 on success, -1 on error
+ */
+static int bn_dec_resize(bn_dec *src, int size)
+{
+    if (!src || size <= 0)
+        return -1;
+    if (size > src->capacity) {
+        /* grow geometrically, a shrink keeps the buffer */
+        int capacity = max(size, 2 * src->capacity);
+        bn_data *number = kvmalloc(sizeof(bn_data) * capacity, GFP_KERNEL);
+        if (!number)
+            return -1;
+        memcpy(number, src->number, sizeof(bn_data) * src->size);
+        kvfree(src->number);
+        src->number = number;
+        src->capacity = capacity;
+    }
+    if (size > src->size)
+        memset(src->number + src->size, 0,
+               sizeof(bn_data) * (size - src->size));
+    src->size = size;
+    return 0;
+}
+
+/* drop the leading zero limbs of src, min size = 1, never fails */
+static void bn_dec_trim(bn_dec *src)
+{
+    while (src->size > 1 && !src->number[src->size - 1])
+        src->size--;
+}
+
+/* swap bn_dec ptr */
+void bn_dec_swap(bn_dec *a, bn_dec *b)
+{
+    bn_dec tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/* r[an] = a[an] + b[bn], and return the carry (an >= bn, r may alias a) */
+static bn_data _dec_add_limbs(bn_data *r,
+                              const bn_data *a,
+                              int an,
+                              const bn_data *b,
+                              int bn)
+{
+    bn_data carry = 0;
+    for (int i = 0; i < an; i++) {
+        bn_data sum = a[i] + (i < bn ? b[i] : 0) + carry;
+        carry = sum >= BN_DEC_LIMB_BASE;
+        r[i] = carry ? sum - BN_DEC_LIMB_BASE : sum;
+    }
+    return carry;
+}
+
+/* r[an] = a[an] - b[bn], and return the borrow (an >= bn, r may alias a) */
+static bn_data _dec_sub_limbs(bn_data *r,
+                              const bn_data *a,
+                              int an,
+                              const bn_data *b,
+                              int bn)
+{
+    bn_data borrow = 0;
+    for (int i = 0; i < an; i++) {
+        bn_data sub = (i < bn ? b[i] : 0) + borrow;
+        borrow = a[i] < sub;
+        r[i] = borrow ? a[i] + BN_DEC_LIMB_BASE - sub : a[i] - sub;
+    }
+    return borrow;
+}
+
+/*
+ * hi:lo = a x b + c + d, store hi:lo % BN_DEC_LIMB_BASE into *r
+ * and return hi:lo / BN_DEC_LIMB_BASE
+ */
+static inline bn_data _dec_muladd(bn_data a,
+                                  bn_data b,
+                                  bn_data c,
+                                  bn_data d,
+                                  bn_data *r)
+{
+    bn_data_tmp_u t = (bn_data_tmp_u) a * b + c + d;
+    return bn_div_limb(t >> BN_WSIZE, t, BN_DEC_LIMB_BASE, r);
+}
+
+/* r[an + bn] = a[an] x b[bn] using long multiplication */
+static void _dec_mult_basecase(bn_data *r,
+                               const bn_data *a,
+                               int an,
+                               const bn_data *b,
+                               int bn)
+{
+    memset(r, 0, sizeof(bn_data) * an);
+    for (int j = 0; j < bn; j++) {
+        bn_data carry = 0;
+        for (int i = 0; i < an; i++)
+            carry = _dec_muladd(a[i], b[j], r[i + j], carry, &r[i + j]);
+        r[an + j] = carry;
+    }
+}
+
+/* limbs of workspace that _dec_kara_mult may use for n-limb input */
+#define DEC_KARA_SCRATCH(n) (4 * (n) + 16 * BN_WSIZE)
+
+/*
+ * r[an + bn] = a[an] x b[bn] with an >= bn, by Karatsuba
+ * ws should provide at least DEC_KARA_SCRATCH(an) limbs
+ */
+static void _dec_kara_mult(bn_data *r,
+                           const bn_data *a,
+                           int an,
+                           const bn_data *b,
+                           int bn,
+                           bn_data *ws)
+{
+    if (bn < BN_DEC_KARATSUBA_THRESHOLD) {
+        _dec_mult_basecase(r, a, an, b, bn);
+        return;
+    }
+
+    int m = (an + 1) / 2;
+    if (bn <= m) {
+        /* unbalanced: slice a into bn-limb pieces and accumulate */
+        bn_data *t = ws;
+        _dec_kara_mult(r, a, bn, b, bn, ws + 2 * bn);
+        memset(r + 2 * bn, 0, sizeof(bn_data) * (an - bn));
+        for (int i = bn; i < an; i += bn) {
+            int len = an - i < bn ? an - i : bn;
+            _dec_kara_mult(t, b, bn, a + i, len, ws + 2 * bn);
+            _dec_add_limbs(r + i, r + i, an + bn - i, t, bn + len);
+        }
+        return;
+    }
+
+    /* a = a1 * B^m + a0, b = b1 * B^m + b0 */
+    int ha = an - m, hb = bn - m;
+    bn_data *sa = ws;
+    bn_data *sb = sa + m + 1;
+    bn_data *z1 = sb + m + 1;
+    bn_data *next = z1 + 2 * (m + 1);
+    int z1n = 2 * (m + 1);
+
+    sa[m] = _dec_add_limbs(sa, a, m, a + m, ha);
+    sb[m] = _dec_add_limbs(sb, b, m, b + m, hb);
+    _dec_kara_mult(z1, sa, m + 1, sb, m + 1, next);
+    _dec_kara_mult(r, a, m, b, m, next);
+    _dec_kara_mult(r + 2 * m, a + m, ha, b + m, hb, next);
+
+    /* r += (z1 - z0 - z2) * B^m */
+    _dec_sub_limbs(z1, z1, z1n, r, 2 * m);
+    _dec_sub_limbs(z1, z1, z1n, r + 2 * m, ha + hb);
+    while (z1n > 1 && !z1[z1n - 1])
+        z1n--;
+    _dec_add_limbs(r + m, r + m, an + bn - m, z1, z1n);
+}
+
+/*
+ * c = a + b
+ * Note: work for c == a or c == b
+ */
+int bn_dec_add(const bn_dec *a, const bn_dec *b, bn_dec *c)
+{
+    if (a->size < b->size)
+        SWAP(a, b);
+    int d = a->size;
+    /* room for the carry first, resizing c may move a or b when aliased */
+    if (bn_dec_resize(c, d + 1) < 0)
+        return -1;
+    c->size = d;
+    bn_data carry = _dec_add_limbs(c->number, a->number, d, b->number,
+                                   b->size);
+    if (carry) {
+        c->size = d + 1;
+        c->number[d] = carry;
+    }
+    return 0;
+}
+
+/*
+ * c = a - b
+ * Note: a >= b must be true, work for c == a or c == b
+ */
+int bn_dec_sub(const bn_dec *a, const bn_dec *b, bn_dec *c)
+{
+    if (bn_dec_resize(c, a->size) < 0)
+        return -1;
+    _dec_sub_limbs(c->number, a->number, a->size, b->number, b->size);
+    bn_dec_trim(c);
+    return 0;
+}
+
+/*
+ * c = a x b
+ * Note: work for c == a or c == b
+ */
+int bn_dec_mult(const bn_dec *a, const bn_dec *b, bn_dec *c)
+{
+    int d = a->size + b->size;
+    bn_dec *tmp;
+    /* make it work properly when c == a or c == b */
+    if (c == a || c == b) {
+        tmp = c;  // save c
+        c = bn_dec_alloc(d);
+        if (!c)
+            return -1;
+    } else {
+        tmp = NULL;
+        if (bn_dec_resize(c, d) < 0)
+            return -1;
+    }
+
+    if (a->size < b->size)
+        SWAP(a, b);
+    if (b->size < BN_DEC_KARATSUBA_THRESHOLD) {
+        _dec_mult_basecase(c->number, a->number, a->size, b->number,
+                           b->size);
+    } else {
+        bn_data *ws = kvmalloc(sizeof(bn_data) * DEC_KARA_SCRATCH(a->size),
+                              GFP_KERNEL);
+        if (!ws) {
+            if (tmp)
+                bn_dec_free(c);
+            return -1;
+        }
+        _dec_kara_mult(c->number, a->number, a->size, b->number, b->size,
+                       ws);
+        kvfree(ws);
+    }
+    bn_dec_trim(c);
+
+    if (tmp) {
+        bn_dec_swap(tmp, c);  // restore c
+        bn_dec_free(c);
+    }
+    return 0;
+}
+
+/*
+ * calc n-th Fibonacci number and save into dest
+ * using fast doubling algorithm on decimal limbs
+ */
+int bn_dec_fdoubling(bn_dec *dest, uint64_t n)
+{
+    if (bn_dec_resize(dest, 1) < 0)
+        return -1;
+    if (n < 2) {  // Fib(0) = 0, Fib(1) = 1
+        dest->number[0] = n;
+        return 0;
+    }
+
+    bn_dec *f1 = dest;            /* F(k) */
+    bn_dec *f2 = bn_dec_alloc(1); /* F(k+1) */
+    bn_dec *k = bn_dec_alloc(1);
+    bn_dec *t = bn_dec_alloc(1);
+    int rc = f2 && k && t ? 0 : -1;
+    f1->number[0] = 0;
+    if (f2)
+        f2->number[0] = 1;
+
+    /*
+     * walk through the digit of n, a failed step leaves its operands
+     * as they were, so the rest of the step is harmless
+     */
+    for (uint64_t i = 1ULL << (63 - __builtin_clzll(n)); i && !rc; i >>= 1) {
+        /* F(2k) = F(k) * [ 2 * F(k+1) – F(k) ] */
+        rc |= bn_dec_add(f2, f2, k);    // k = 2 * F(k+1)
+        rc |= bn_dec_sub(k, f1, k);     // k = 2 * F(k+1) – F(k)
+        rc |= bn_dec_mult(k, f1, t);    // t = k * f1 = F(2k)
+
+        /* F(2k+1) = F(k)^2 + F(k+1)^2 */
+        rc |= bn_dec_mult(f1, f1, k);   // k = F(k)^2
+        rc |= bn_dec_mult(f2, f2, f1);  // f1 = F(k+1)^2
+        rc |= bn_dec_add(k, f1, f2);    // f2 = F(2k+1)
+        bn_dec_swap(f1, t);             // f1 = F(2k)
+
+        if (n & i) {
+            bn_dec_swap(f1, f2);           // f1 = F(2k+1)
+            rc |= bn_dec_add(f1, f2, f2);  // f2 = F(2k+2)
+        }
+    }
+    // return f1
+    bn_dec_free(f2);
+    bn_dec_free(k);
+    bn_dec_free(t);
+    return rc;
+}
+
+/*
+ * output bn_dec to decimal string, one snprintf per limb
+ * Note: the returned string should be freed with the kvfree()
+ */
+char *bn_dec_to_string(const bn_dec *src)
+{
+    size_t len = (size_t) src->size * BN_DEC_LIMB_DIGITS + 1;
+    char *s = kvmalloc(len, GFP_KERNEL);
+    if (!s)
+        return NULL;
+
+    char *p = s;
+    p += snprintf(p, len, "%llu",
+                  (unsigned long long) src->number[src->size - 1]);
+    for (int i = src->size - 2; i >= 0; i--)
+        p += snprintf(p, len - (p - s), "%0*llu", BN_DEC_LIMB_DIGITS,
+                      (unsigned long long) src->number[i]);
+    return s;
+}
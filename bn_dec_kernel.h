@@ -0,0 +1,77 @@
+#ifndef BN_DEC_KERNEL_H
+#define BN_DEC_KERNEL_H
+
+#include "bn_kernel.h"
+
+#if BN_WSIZE == 64
+#define BN_DEC_LIMB_DIGITS 18
+#define BN_DEC_LIMB_BASE 1000000000000000000ULL
+#else
+#define BN_DEC_LIMB_DIGITS 9
+#define BN_DEC_LIMB_BASE 1000000000U
+#endif
+
+/* operands of at least this many limbs are multiplied by Karatsuba */
+#define BN_DEC_KARATSUBA_THRESHOLD 24
+
+/*
+ * bignum with decimal limbs, each holding BN_DEC_LIMB_DIGITS digits,
+ * so that printing it needs no radix conversion
+ * number[0] contains least significant digits
+ * number[size - 1] contains most significant digits
+ * capacity is the number of limbs the buffer behind number can hold,
+ * it grows geometrically and never shrinks
+ * only non-negative values are represented
+ */
+typedef struct _bn_dec {
+    bn_data *number;
+    int size;
+    int capacity;
+} bn_dec;
+
+/*
+ * alloc a bn_dec structure with the given size
+ * the value is initialized to 0, NULL if out of memory
+ */
+bn_dec *bn_dec_alloc(size_t size);
+
+/*
+ * free entire bn_dec data structure
+ * return 0 on success, -1 on error
+ */
+int bn_dec_free(bn_dec *src);
+
+/* swap bn_dec ptr */
+void bn_dec_swap(bn_dec *a, bn_dec *b);
+
+/*
+ * c = a + b
+ * return 0 on success, -1 on error
+ */
+int bn_dec_add(const bn_dec *a, const bn_dec *b, bn_dec *c);
+
+/*
+ * c = a - b, a >= b must be true
+ * return 0 on success, -1 on error
+ */
+int bn_dec_sub(const bn_dec *a, const bn_dec *b, bn_dec *c);
+
+/*
+ * c = a x b
+ * return 0 on success, -1 on error
+ */
+int bn_dec_mult(const bn_dec *a, const bn_dec *b, bn_dec *c);
+
+/*
+ * calc n-th Fibonacci number and save into dest
+ * return 0 on success, -1 on error
+ */
+int bn_dec_fdoubling(bn_dec *dest, uint64_t n);
+
+/*
+ * output bn_dec to decimal string
+ * Note: the returned string should be freed with the kvfree()
+ */
+char *bn_dec_to_string(const bn_dec *src);
+
+#endif /* BN_DEC_KERNEL_H */
@@ -1,7 +1,12 @@
+#ifndef BN_KERNEL_H
+#define BN_KERNEL_H
+
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/types.h>
 
+#include "fibdrv_ioctl.h"
+
 #if defined(__LP64__) || defined(__x86_64__) || defined(__amd64__) || \
     defined(__aarch64__)
 #define BN_WSIZE 64
@@ -15,29 +20,128 @@ typedef unsigned __int128 bn_data_tmp_u;  // gcc support __int128
 typedef __int128 bn_data_tmp_s;           // gcc support __int128
 #elif BN_WSIZE == 32
 typedef uint32_t bn_data;
-typedef uint64_t bn_data_tmp;
+typedef uint64_t bn_data_tmp_u;
+typedef int64_t bn_data_tmp_s;
 #else
 #error "BN_WSIZE must be 32 or 64"
 #endif
 
+/* x86-64 inline assembly, define BN_NO_ASM to build the portable C */
+#if defined(__x86_64__) && BN_WSIZE == 64 && !defined(BN_NO_ASM)
+#define BN_ASM_X86_64
+#endif
+
+/* return the low limb of a x b and store the high limb into *hi */
+static inline bn_data bn_mul_limb(bn_data a, bn_data b, bn_data *hi)
+{
+#ifdef BN_ASM_X86_64
+    bn_data lo;
+    __asm__("mulq %3" : "=a"(lo), "=d"(*hi) : "%0"(a), "rm"(b));
+    return lo;
+#else
+    bn_data_tmp_u t = (bn_data_tmp_u) a * b;
+    *hi = t >> BN_WSIZE;
+    return t;
+#endif
+}
+
+/*
+ * return hi:lo / d and store the remainder into *r
+ * Note: hi < d must be true
+ */
+static inline bn_data bn_div_limb(bn_data hi,
+                                  bn_data lo,
+                                  bn_data d,
+                                  bn_data *r)
+{
+#ifdef BN_ASM_X86_64
+    bn_data q;
+    __asm__("divq %4" : "=a"(q), "=d"(*r) : "a"(lo), "d"(hi), "rm"(d));
+    return q;
+#else
+    /*
+     * schoolbook division on half limbs (Hacker's Delight, divlu), it
+     * needs no double limb division, which the kernel lacks
+     */
+    const int h = BN_WSIZE / 2;
+    const bn_data b = (bn_data) 1 << h;
+    int s = __builtin_clzll(d) - (64 - BN_WSIZE);
+    d <<= s;
+    bn_data d1 = d >> h, d0 = d & (b - 1);
+    bn_data u32 = s ? hi << s | lo >> (BN_WSIZE - s) : hi;
+    bn_data u10 = lo << s, u1 = u10 >> h, u0 = u10 & (b - 1);
+
+    bn_data q1 = u32 / d1, rhat = u32 - q1 * d1;
+    while (q1 >= b || q1 * d0 > (rhat << h | u1)) {
+        q1--;
+        if ((rhat += d1) >= b)
+            break;
+    }
+    bn_data u21 = (u32 << h) + u1 - q1 * d;
+    bn_data q0 = u21 / d1;
+    rhat = u21 - q0 * d1;
+    while (q0 >= b || q0 * d0 > (rhat << h | u0)) {
+        q0--;
+        if ((rhat += d1) >= b)
+            break;
+    }
+    *r = ((u21 << h) + u0 - q0 * d) >> s;
+    return q1 << h | q0;
+#endif
+}
+
+struct _bn_arena;
+
 /*
  * bignum data structure
  * number[0] contains least significant bits
  * number[size - 1] contains most significant bits
+ * capacity is the number of limbs the buffer behind number can hold,
+ * it grows geometrically and never shrinks
  * sign = 1 for negative number
+ * arena is the scratch arena the bn was carved from, NULL for the heap
  */
 typedef struct _bn {
     bn_data *number;
     int size;
+    int capacity;
     int sign;
+    struct _bn_arena *arena;
 } bn;
 
+/*
+ * scratch arena for bn temporaries
+ * bn structures, their limbs and the multiplication workspace are carved
+ * from one block sized up front, whatever does not fit spills to the heap
+ * and is given back on bn_arena_reset()
+ */
+typedef struct _bn_arena {
+    char *base;
+    size_t size;  /* bytes in base */
+    size_t used;  /* bytes carved so far */
+    size_t limbs; /* limbs given to each carved bn */
+    void *spill;  /* heap blocks to free on reset */
+} bn_arena;
+
+/*
+ * heap allocations and reallocations done by the bn library
+ * statistics only, updates from concurrent opens and bn_par_run threads
+ * may be lost
+ */
+extern unsigned long bn_nr_alloc, bn_nr_realloc;
+
 /*
  * output bn to decimal string
- * Note: the returned string should be freed with the kfree()
+ * Note: the returned string should be freed with the kvfree()
  */
 char *bn_to_string(const bn *src);
 
+/*
+ * output bn to hexadecimal string
+ * Note: the returned string should be freed with the kvfree()
+ */
+char *bn_to_hex(const bn *src);
+
 /*
  * alloc a bn structure with the given size
  * the value is initialized to +0
@@ -46,10 +150,41 @@ bn *bn_alloc(size_t size);
 
 /*
  * free entire bn data structure
+ * bns carved from an arena are given back on bn_arena_reset()
  * return 0 on success, -1 on error
  */
 int bn_free(bn *src);
 
+/*
+ * make sure src holds at least capacity limbs without reallocating
+ * return 0 on success, -1 on error
+ */
+int bn_reserve(bn *src, size_t capacity);
+
+/* alloc an empty arena, reserve it before use */
+bn_arena *bn_arena_new(void);
+
+/*
+ * reset arena and make sure it holds the result and temporaries of
+ * operands up to limbs long
+ * return 0 on success, -1 on error
+ */
+int bn_arena_reserve(bn_arena *arena, size_t limbs);
+
+/* give back everything carved from arena */
+void bn_arena_reset(bn_arena *arena);
+
+void bn_arena_free(bn_arena *arena);
+
+/*
+ * alloc a bn of the given size from arena, from the heap if arena is NULL
+ * the value is initialized to +0
+ */
+bn *bn_alloc_arena(bn_arena *arena, size_t size);
+
+/* limbs of the largest value bn_fib_* and bn_fdoubling_* handle for F(n) */
+size_t bn_fib_limbs(uint64_t n);
+
 /*
  * copy the value from src to dest
  * return 0 on success, -1 on error
@@ -64,14 +199,17 @@ int bn_cpy(bn *dest, bn *src);
  */
 int bn_cmp(const bn *a, const bn *b);
 
-/* swap bn ptr */
+/*
+ * swap bn ptr
+ * a and b should come from the same arena, or both from the heap
+ */
 void bn_swap(bn *a, bn *b);
 
-/* dest = src << shift (maximun shift 31) */
-void bn_lshift(bn *src, size_t shift, bn *dest);
+/* dest = src << shift (maximun shift 31), dest may be src */
+void bn_lshift(const bn *src, size_t shift, bn *dest);
 
-/* right bit shift on bn (maximun shift 31) */
-// void bn_rshift(bn *src, size_t shift);
+/* src = src >> shift (maximun shift 31) */
+void bn_rshift(bn *src, size_t shift);
 
 /* c = a + b */
 void bn_add(const bn *a, const bn *b, bn *c);
@@ -79,12 +217,137 @@ void bn_add(const bn *a, const bn *b, bn *c);
 /* c = a - b */
 void bn_sub(const bn *a, const bn *b, bn *c);
 
-/* c = a x b */
-void bn_mult(const bn *a, const bn *b, bn *c);
+/*
+ * operands of at least bn_karatsuba_threshold limbs are multiplied with
+ * the Karatsuba algorithm, smaller ones with long multiplication
+ */
+#define BN_KARATSUBA_THRESHOLD 32
+extern int bn_karatsuba_threshold;
+
+/*
+ * operands of at least bn_toom3_threshold limbs are split in three with
+ * the Toom-Cook algorithm instead, the default is the crossover with the
+ * default Karatsuba threshold on x86-64; client_tune finds both locally
+ */
+#define BN_TOOM3_THRESHOLD 256
+extern int bn_toom3_threshold;
+
+/*
+ * operands of at least bn_ntt_threshold limbs are multiplied with a
+ * three-prime number theoretic transform (64-bit limbs only)
+ */
+#define BN_NTT_THRESHOLD 2048
+extern int bn_ntt_threshold;
+
+/* run fn(arg, 0) to fn(arg, n - 1), possibly concurrently */
+typedef void (*bn_par_fn)(void *arg, int i);
+
+/*
+ * when set, the three products of a fast doubling step and the three
+ * transforms of an NTT multiply on operands of at least bn_par_threshold
+ * limbs go through bn_par_run, which may run them on other CPUs, as long
+ * as bn_par_max allows more than one thread; NULL runs them in turn
+ */
+extern void (*bn_par_run)(bn_par_fn fn, void *arg, int n);
+#define BN_PAR_THRESHOLD 1024
+extern int bn_par_threshold;
+extern int bn_par_max;
+
+/* bn_cpu_features flags */
+#define BN_CPU_ADX 1 /* mulx, adcx and adox (BMI2 and ADX) */
+#define BN_CPU_AVX2 2   /* 256-bit vector additions */
+#define BN_CPU_AVX512 4 /* 512-bit vector additions (AVX-512F) */
+
+/*
+ * CPU features used by the limb kernels, bn_init() clears those the CPU
+ * lacks, clear flags before it to leave features unused
+ */
+extern unsigned int bn_cpu_features;
+
+/* pick the limb kernels for the running CPU */
+void bn_init(void);
+
+/*
+ * c = a x b
+ * return 0 on success, -1 on error
+ */
+int bn_mult(const bn *a, const bn *b, bn *c);
+
+/*
+ * c = a^2, cheaper than bn_mult(a, a, c)
+ * return 0 on success, -1 on error
+ */
+int bn_sqr(const bn *a, bn *c);
+
+/*
+ * calc n-th Fibonacci number and save into dest
+ * temporaries are taken from the arena of dest
+ */
+void bn_fib_v0(bn *dest, uint64_t n);
+void bn_fib_v1(bn *dest, uint64_t n);
+
+void bn_fdoubling_v0(bn *dest, uint64_t n);
+void bn_fdoubling_v1(bn *dest, uint64_t n);
+
+/*
+ * calc F(n) into dest by powers of the Q-matrix [[1, 1], [1, 0]], three
+ * squares and a product per bit of n
+ */
+void bn_fib_qmatrix(bn *dest, uint64_t n);
+
+/*
+ * calc F(n) into dest by doubling F(k) and the Lucas number L(k), two
+ * squares per bit of n
+ */
+void bn_fib_lucas(bn *dest, uint64_t n);
+
+/*
+ * calc F(n) into dest by fast doubling on F(k) and F(k-1), two squares
+ * per bit of n and a single product for the last one
+ */
+void bn_fdoubling_v2(bn *dest, uint64_t n);
+
+/*
+ * calc F(n) into f1 and F(n+1) into f2 using fast doubling
+ * temporaries are taken from the arena of f1, f2 should share it
+ */
+void bn_fdoubling_pair(bn *f1, bn *f2, uint64_t n);
+
+/*
+ * dest = F(k + d) from fk = F(k) and fk1 = F(k + 1) using the addition
+ * formula F(k + d) = F(k + 1) * F(d) + F(k) * F(d - 1)
+ * Note: dest must not be fk or fk1
+ */
+void bn_fib_resume(bn *dest, const bn *fk, const bn *fk1, uint64_t d);
+
+/* largest n with F(n) below 2^64 */
+#define BN_FIB_U64_MAX 93
+
+/* F(n) for n <= BN_FIB_U64_MAX, looked up in the table of fib_table.h */
+uint64_t bn_fib_u64(uint64_t n);
+
+/*
+ * called on step i of a loop linear in n, yields the CPU every
+ * BN_FIB_YIELD_STEPS steps
+ * return 1 once the caller is killed and the loop should stop
+ */
+#define BN_FIB_YIELD_STEPS 4096
+int bn_fib_yield(uint64_t i);
+
+/* an algorithm of fibdrv */
+struct bn_fib_algo {
+    const char *name;
+    /* F(n) into dest, temporaries from its arena; NULL if not on a bn */
+    void (*fib)(bn *dest, uint64_t n);
+};
+
+/*
+ * the algorithms by their FIB_ALGO id, which the driver, us_debug and
+ * client_perf all dispatch through; unused ids have a NULL name
+ */
+extern const struct bn_fib_algo bn_fib_algos[FIB_ALGO_NR];
 
-/* calc n-th Fibonacci number and save into dest */
-void bn_fib_v0(bn *dest, unsigned int n);
-void bn_fib_v1(bn *dest, unsigned int n);
+/* FIB_ALGO id of the algorithm called name, -1 if there is none */
+int bn_fib_algo_find(const char *name);
 
-void bn_fdoubling_v0(bn *dest, unsigned int n);
-void bn_fdoubling_v1(bn *dest, unsigned int n);
\ No newline at end of file
+#endif /* BN_KERNEL_H */
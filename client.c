@@ -3,13 +3,17 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "fibdrv_ioctl.h"
+
 
 #define FIB_DEV "/dev/fibonacci"
 #define offset 2000 /* TODO: try test something bigger than the limit */
-#define mode 2
+/* sequential stream, each read advances the position by one */
+#define fib_mode FIB_ALGO_STREAM
 
 
 int main()
@@ -20,11 +24,18 @@ int main()
         perror("Failed to open character device");
         exit(1);
     }
+    __u32 mode = fib_mode;
+    if (ioctl(fd, FIB_IOC_SET_MODE, &mode) < 0) {
+        perror("FIB_IOC_SET_MODE");
+        exit(1);
+    }
+    lseek(fd, 0, SEEK_SET);
     for (int i = 0; i <= offset; i++) {
-        lseek(fd, i, SEEK_SET);
-        int sz = read(fd, buf, mode);
-        if (sz)
+        /* one value per read, its digits and a newline */
+        ssize_t sz = read(fd, buf, sizeof(buf) - 1);
+        if (sz <= 0 || buf[sz - 1] != '\n')
             return 0;
+        buf[sz - 1] = '\0';
         printf("Reading from " FIB_DEV
                " at offset %d, returned the sequence "
                "%s.\n",
@@ -0,0 +1,80 @@
+#include <time.h>
+
+#include "bn.h"
+
+#define min_limbs 1
+#define max_limbs (1 << 20)
+#define sample_size 5
+/* bytes summed per sample, so small sums get enough iterations */
+#define sample_bytes (1 << 28)
+
+/* limb kernels to compare, in plot column order */
+static const unsigned int features[] = {0, BN_CPU_AVX2, BN_CPU_AVX512};
+#define FEATURE_NUM (sizeof(features) / sizeof(features[0]))
+
+__attribute__((always_inline)) static inline void escape(void *p)
+{
+    __asm__ volatile("" : : "g"(p) : "memory");
+}
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/* bn_add throughput in GB/s by limb count, a and b read and c written */
+int main(int argc, char const *argv[])
+{
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_add", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+
+    bn *a = bn_alloc(max_limbs), *b = bn_alloc(max_limbs);
+    bn *c = bn_alloc(max_limbs + 1);
+    srand(1);
+    for (int i = 0; i < max_limbs; i++) {
+        for (int j = 0; j < (int) sizeof(bn_data); j++) {
+            a->number[i] = a->number[i] << 8 | (rand() & 0xff);
+            b->number[i] = b->number[i] << 8 | (rand() & 0xff);
+        }
+    }
+
+    for (int n = min_limbs; n <= max_limbs; n *= 2) {
+        a->size = b->size = n;
+        long long bytes = 3LL * n * sizeof(bn_data);
+        long iter = sample_bytes / bytes + 1;
+        fprintf(fp, "%d ", n);
+        for (size_t f = 0; f < FEATURE_NUM; f++) {
+            bn_cpu_features = features[f];
+            bn_init();
+            if (bn_cpu_features != features[f]) {
+                /* the CPU lacks it */
+                fprintf(fp, "- ");
+                continue;
+            }
+            long long best = 0;
+            for (int s = 0; s < sample_size; s++) {
+                struct timespec t1, t2;
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                for (long i = 0; i < iter; i++) {
+                    bn_add(a, b, c);
+                    escape(c->number);
+                }
+                clock_gettime(CLOCK_MONOTONIC, &t2);
+                long long t = elapse(&t1, &t2);
+                if (!best || t < best)
+                    best = t;
+            }
+            fprintf(fp, "%.2f ", (double) bytes * iter / best);
+        }
+        fprintf(fp, "\n");
+    }
+    bn_free(a);
+    bn_free(b);
+    bn_free(c);
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv_ioctl.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define rounds 20
+#define offset_range 1000
+#define fib_mode FIB_ALGO_FDOUBLING
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/* per-value cost of the lseek/read loop of client.c, in ns */
+static double read_loop(int fd, int nr)
+{
+    static char buf[offset_range];
+    struct timespec t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < nr; i++) {
+            lseek(fd, i % offset_range, SEEK_SET);
+            read(fd, buf, sizeof(buf));
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    return (double) elapse(&t1, &t2) / rounds / nr;
+}
+
+/* per-value cost of one FIB_IOC_BATCH call for the same values, in ns */
+static double batch(int fd, int nr, struct fib_req *reqs, char *buf)
+{
+    struct fib_batch b = {
+        .reqs = (unsigned long) reqs,
+        .buf = (unsigned long) buf,
+        .size = (unsigned long long) nr * offset_range,
+        .nr = nr,
+    };
+    struct timespec t1, t2;
+    for (int i = 0; i < nr; i++) {
+        memset(&reqs[i], 0, sizeof(reqs[i]));
+        reqs[i].n = i % offset_range;
+        reqs[i].mode = fib_mode;
+        reqs[i].format = FIB_FMT_DEC;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (int r = 0; r < rounds; r++) {
+        if (ioctl(fd, FIB_IOC_BATCH, &b) < 0) {
+            perror("FIB_IOC_BATCH");
+            exit(1);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    for (int i = 0; i < nr; i++) {
+        if (reqs[i].status)
+            fprintf(stderr, "F(%llu): status %d\n", reqs[i].n, reqs[i].status);
+    }
+    return (double) elapse(&t1, &t2) / rounds / nr;
+}
+
+/* compare lseek/read against batched ioctl for growing batch sizes */
+int main(int argc, char const *argv[])
+{
+    static const int sizes[] = {1, 10, 100, 1000, 10000};
+    int max = sizes[sizeof(sizes) / sizeof(sizes[0]) - 1];
+    struct fib_req *reqs = malloc(sizeof(*reqs) * max);
+    char *buf = malloc((size_t) max * offset_range);
+    if (!reqs || !buf) {
+        perror("malloc");
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    __u32 mode = fib_mode;
+    if (ioctl(fd, FIB_IOC_SET_MODE, &mode) < 0) {
+        perror("FIB_IOC_SET_MODE");
+        exit(1);
+    }
+
+    printf("%8s %14s %14s\n", "values", "read (ns/val)", "batch (ns/val)");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int nr = sizes[s];
+        double r = read_loop(fd, nr);
+        double b = batch(fd, nr, reqs, buf);
+        printf("%8d %14.1f %14.1f\n", nr, r, b);
+    }
+
+    close(fd);
+    free(reqs);
+    free(buf);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <time.h>
+
+#include "bn.h"
+
+#define sample_size 3
+
+/* 1, 2 and 5 of each decade */
+static const uint64_t ns[] = {
+    1000,   2000,   5000,    10000,   20000,   50000,   100000,
+    200000, 500000, 1000000, 2000000, 5000000, 10000000,
+};
+#define N_NUM (sizeof(ns) / sizeof(ns[0]))
+
+/* fast doubling variants to compare, in plot column order */
+static const int algos[] = {FIB_ALGO_FDOUBLING_V0, FIB_ALGO_FDOUBLING,
+                            FIB_ALGO_FDOUBLING_V2};
+#define ALGO_NUM (sizeof(algos) / sizeof(algos[0]))
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/* ns to compute F(n) by algo, the best of sample_size runs */
+static long long measure(bn_arena *arena, int algo, uint64_t n)
+{
+    long long best = 0;
+    for (int s = 0; s < sample_size; s++) {
+        struct timespec t1, t2;
+        if (bn_arena_reserve(arena, bn_fib_limbs(n))) {
+            perror("bn_arena_reserve");
+            exit(1);
+        }
+        bn *fib = bn_alloc_arena(arena, 1);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        bn_fib_algos[algo].fib(fib, n);
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        long long t = elapse(&t1, &t2);
+        if (!best || t < best)
+            best = t;
+    }
+    return best;
+}
+
+/* bn_fdoubling_v0, v1 and v2 time in ms by n, then v2 over v1 */
+int main(int argc, char const *argv[])
+{
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_fdoubling", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+
+    bn_init();
+    bn_arena *arena = bn_arena_new();
+    for (size_t i = 0; i < N_NUM; i++) {
+        uint64_t n = ns[i];
+        double ms[ALGO_NUM];
+        printf("F(%llu):", (unsigned long long) n);
+        fprintf(fp, "%llu ", (unsigned long long) n);
+        for (size_t a = 0; a < ALGO_NUM; a++) {
+            ms[a] = measure(arena, algos[a], n) / 1e6;
+            printf(" %s %.3f ms", bn_fib_algos[algos[a]].name, ms[a]);
+            fprintf(fp, "%.6f ", ms[a]);
+        }
+        printf("\n");
+        fprintf(fp, "%.3f\n", ms[2] / ms[1]);
+        fflush(fp);
+    }
+    bn_arena_free(arena);
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv_ioctl.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define sample_size 20
+#define offset 100000
+#define step 1000
+#define fib_mode FIB_ALGO_FDOUBLING
+
+/* output formats to compare, in plot column order */
+static const __u32 formats[] = {FIB_FMT_DEC, FIB_FMT_HEX, FIB_FMT_BIN};
+#define FORMAT_NUM (sizeof(formats) / sizeof(formats[0]))
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/* F(n) in the current format of fd, return bytes read */
+static ssize_t read_value(int fd, int n, char *buf, size_t size)
+{
+    lseek(fd, n, SEEK_SET);
+    return read(fd, buf, size);
+}
+
+/* the hex digits the limbs of bin should read as */
+static void bin_to_hex(const char *bin, char *hex)
+{
+    struct fib_bin_hdr hdr;
+    memcpy(&hdr, bin, sizeof(hdr));
+    const char *limbs = bin + sizeof(hdr);
+    int width = 2 * hdr.limb_size;
+    char *p = hex;
+    for (int i = hdr.size - 1; i >= 0; i--) {
+        uint64_t x = 0;
+        memcpy(&x, limbs + (size_t) i * hdr.limb_size, hdr.limb_size);
+        /* only the top limb drops its leading zeros */
+        int w = i == (int) hdr.size - 1 ? 1 : width;
+        p += snprintf(p, width + 1, "%0*llx", w, (unsigned long long) x);
+    }
+}
+
+/* read() latency of F(n) in decimal, hex and binary limbs, in ns */
+int main(int argc, char const *argv[])
+{
+    static char buf[FORMAT_NUM][offset];
+    static char hex[offset];
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_format", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    __u32 mode = fib_mode;
+    if (ioctl(fd, FIB_IOC_SET_MODE, &mode) < 0) {
+        perror("FIB_IOC_SET_MODE");
+        exit(1);
+    }
+
+    for (int i = 0; i <= offset; i += step) {
+        ssize_t len[FORMAT_NUM];
+        fprintf(fp, "%d ", i);
+        for (size_t f = 0; f < FORMAT_NUM; f++) {
+            long long sum = 0;
+            ioctl(fd, FIB_IOC_SET_FORMAT, &formats[f]);
+            len[f] = read_value(fd, i, buf[f], offset); /* warm up */
+            for (int n = 0; n < sample_size; n++) {
+                struct timespec t1, t2;
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                read_value(fd, i, buf[f], offset);
+                clock_gettime(CLOCK_MONOTONIC, &t2);
+                sum += elapse(&t1, &t2);
+            }
+            fprintf(fp, "%lld ", sum / sample_size);
+        }
+        fprintf(fp, "\n");
+
+        /* hex is the newline-terminated text of the limbs */
+        bin_to_hex(buf[2], hex);
+        if (len[1] <= 0 || len[2] <= 0 ||
+            strncmp(buf[1], hex, len[1] - 1) || hex[len[1] - 1]) {
+            fprintf(stderr, "F(%d): hex and binary results differ\n", i);
+            exit(1);
+        }
+    }
+    close(fd);
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv_ioctl.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define sample_size 20
+#define offset 100000
+#define step 1000
+
+/* read modes to compare: bn_fdoubling_v1 + bn_to_string, decimal limbs */
+static const int modes[] = {FIB_ALGO_FDOUBLING, FIB_ALGO_DEC};
+#define MODE_NUM (sizeof(modes) / sizeof(modes[0]))
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/* end-to-end read() latency as seen from userspace, in ns */
+int main(int argc, char const *argv[])
+{
+    static char buf[offset];
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_read_latency", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    for (int i = 0; i <= offset; i += step) {
+        fprintf(fp, "%d ", i);
+        for (size_t m = 0; m < MODE_NUM; m++) {
+            long long sum = 0;
+            __u32 mode = modes[m];
+            ioctl(fd, FIB_IOC_SET_MODE, &mode);
+            lseek(fd, i, SEEK_SET);
+            read(fd, buf, sizeof(buf)); /* warm up */
+            for (int n = 0; n < sample_size; n++) {
+                struct timespec t1, t2;
+                lseek(fd, i, SEEK_SET);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                read(fd, buf, sizeof(buf));
+                clock_gettime(CLOCK_MONOTONIC, &t2);
+                sum += elapse(&t1, &t2);
+            }
+            fprintf(fp, "%lld ", sum / sample_size);
+        }
+        fprintf(fp, "\n");
+    }
+    close(fd);
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv_ioctl.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define sample_size 20
+#define offset 100000
+#define step 5000
+#define fib_mode FIB_ALGO_FDOUBLING
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/*
+ * compare read() into a user buffer against FIB_IOC_MAP into the
+ * mmap()ed region, which also tells the length of the result
+ */
+int main(int argc, char const *argv[])
+{
+    static char buf[offset];
+    __u64 size;
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    __u32 mode = fib_mode;
+    if (ioctl(fd, FIB_IOC_SET_MODE, &mode) < 0) {
+        perror("FIB_IOC_SET_MODE");
+        exit(1);
+    }
+    if (ioctl(fd, FIB_IOC_MAP_SIZE, &size) < 0) {
+        perror("FIB_IOC_MAP_SIZE");
+        exit(1);
+    }
+    char *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    const struct fib_map_hdr *hdr = (const void *) map;
+    const char *data = map + FIB_MAP_DATA;
+
+    printf("%8s %10s %12s %12s %12s\n", "n", "digits", "read (ns)",
+           "mmap (ns)", "limbs (ns)");
+    for (int i = 0; i <= offset; i += step) {
+        struct fib_map_req req = {.n = i, .mode = fib_mode};
+        struct timespec t1, t2;
+        long long t_read = 0, t_map = 0, t_bin = 0;
+
+        for (int n = 0; n < sample_size; n++) {
+            lseek(fd, i, SEEK_SET);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            ssize_t sz = read(fd, buf, sizeof(buf) - 1);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            t_read += elapse(&t1, &t2);
+            buf[sz > 0 ? sz - 1 : 0] = '\0'; /* drop the newline */
+
+            req.format = FIB_FMT_DEC;
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            ioctl(fd, FIB_IOC_MAP, &req);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            t_map += elapse(&t1, &t2);
+        }
+        if (hdr->status || strcmp(buf, data)) {
+            fprintf(stderr, "F(%d): mmap result differs from read\n", i);
+            exit(1);
+        }
+        size_t digits = hdr->len - 1;
+
+        for (int n = 0; n < sample_size; n++) {
+            req.format = FIB_FMT_BIN;
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            ioctl(fd, FIB_IOC_MAP, &req);
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            t_bin += elapse(&t1, &t2);
+        }
+        printf("%8d %10zu %12lld %12lld %12lld\n", i, digits,
+               t_read / sample_size, t_map / sample_size,
+               t_bin / sample_size);
+    }
+
+    munmap(map, size);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv_ioctl.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define ITER_TIMES 10000
+
+/*
+ * a word-sized prime, the usual 32-bit one and one small enough to have
+ * n reduced by its Pisano period
+ */
+static const unsigned long long ms[] = {18446744073709551557ULL, 1000000007,
+                                        1000};
+#define M_NUM (sizeof(ms) / sizeof(ms[0]))
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/* ns per FIB_IOC_MOD call for n = 2^k - 1, k = 1 to 64, by modulus */
+int main(int argc, char const *argv[])
+{
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_mod", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    for (int k = 1; k <= 64; k++) {
+        unsigned long long n = k == 64 ? ~0ULL : (1ULL << k) - 1;
+        fprintf(fp, "%d ", k);
+        for (size_t i = 0; i < M_NUM; i++) {
+            struct fib_mod req = {.n = n, .m = ms[i]};
+            struct timespec t1, t2;
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            for (int j = 0; j < ITER_TIMES; j++) {
+                if (ioctl(fd, FIB_IOC_MOD, &req) < 0) {
+                    perror("FIB_IOC_MOD");
+                    exit(1);
+                }
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            fprintf(fp, "%.1f ", (double) elapse(&t1, &t2) / ITER_TIMES);
+        }
+        fprintf(fp, "\n");
+    }
+    close(fd);
+    fclose(fp);
+    return 0;
+}
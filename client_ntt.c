@@ -0,0 +1,63 @@
+#include <time.h>
+
+#include "bn.h"
+
+#define sample_size 3
+
+/* 1, 2 and 5 of each decade */
+static const uint64_t ns[] = {
+    1000,   2000,   5000,    10000,   20000,   50000,   100000,
+    200000, 500000, 1000000, 2000000, 5000000, 10000000,
+};
+#define N_NUM (sizeof(ns) / sizeof(ns[0]))
+
+/* multiplication thresholds to compare, in plot column order */
+static const int ntt_thresholds[] = {0x7fffffff, BN_NTT_THRESHOLD};
+#define THRESHOLD_NUM (sizeof(ntt_thresholds) / sizeof(ntt_thresholds[0]))
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/* bn_fdoubling_v1 time in ms by n, Karatsuba only and with the NTT */
+int main(int argc, char const *argv[])
+{
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_ntt", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+
+    bn_init();
+    bn_arena *arena = bn_arena_new();
+    for (size_t i = 0; i < N_NUM; i++) {
+        uint64_t n = ns[i];
+        fprintf(fp, "%llu ", (unsigned long long) n);
+        for (size_t t = 0; t < THRESHOLD_NUM; t++) {
+            bn_ntt_threshold = ntt_thresholds[t];
+            long long best = 0;
+            for (int s = 0; s < sample_size; s++) {
+                struct timespec t1, t2;
+                if (bn_arena_reserve(arena, bn_fib_limbs(n))) {
+                    perror("bn_arena_reserve");
+                    exit(1);
+                }
+                bn *fib = bn_alloc_arena(arena, 1);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                bn_fdoubling_v1(fib, n);
+                clock_gettime(CLOCK_MONOTONIC, &t2);
+                long long t = elapse(&t1, &t2);
+                if (!best || t < best)
+                    best = t;
+            }
+            fprintf(fp, "%.3f ", best / 1e6);
+        }
+        fprintf(fp, "\n");
+        fflush(fp);
+    }
+    bn_arena_free(arena);
+    fclose(fp);
+    return 0;
+}
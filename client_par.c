@@ -0,0 +1,81 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "fibdrv_ioctl.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define PAR_PARAM "/sys/module/fibdrv_bn/parameters/max_parallel"
+#define sample_size 5
+
+static const long long ns[] = {100000, 1000000, 10000000};
+#define N_NUM (sizeof(ns) / sizeof(ns[0]))
+
+static int set_max_parallel(int cpus)
+{
+    FILE *fp = fopen(PAR_PARAM, "w");
+    if (!fp)
+        return -1;
+    fprintf(fp, "%d\n", cpus);
+    return fclose(fp);
+}
+
+/*
+ * bn_fdoubling_v1 in the driver by the CPUs it may use: the time in ms
+ * for each n, then the speedup over one CPU
+ * max_length has to be raised to the largest n first
+ */
+int main(int argc, char const *argv[])
+{
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_par", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    char write_buf[] = "testing writing";
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long long base[N_NUM];
+    for (int p = 1; p <= cpus; p++) {
+        if (set_max_parallel(p)) {
+            perror("Failed to set max_parallel");
+            exit(1);
+        }
+        long long best[N_NUM];
+        for (size_t i = 0; i < N_NUM; i++) {
+            best[i] = 0;
+            for (int s = 0; s < sample_size; s++) {
+                lseek(fd, ns[i], SEEK_SET);
+                /* write() returns the time in ns */
+                long long t = write(fd, write_buf, FIB_ALGO_FDOUBLING);
+                if (!best[i] || t < best[i])
+                    best[i] = t;
+            }
+            if (p == 1)
+                base[i] = best[i];
+        }
+
+        fprintf(fp, "%d ", p);
+        printf("%2d CPUs:", p);
+        for (size_t i = 0; i < N_NUM; i++)
+            fprintf(fp, "%.3f ", best[i] / 1e6);
+        for (size_t i = 0; i < N_NUM; i++) {
+            fprintf(fp, "%.3f ", (double) base[i] / best[i]);
+            printf("  F(%lld) x%.2f", ns[i], (double) base[i] / best[i]);
+        }
+        fprintf(fp, "\n");
+        printf("\n");
+    }
+    set_max_parallel(1);
+    close(fd);
+    fclose(fp);
+    return 0;
+}
@@ -8,13 +8,25 @@ __attribute__((always_inline)) static inline void escape(void *p)
 }
 
 
+/* F(ITH) ITER_TIMES times by the FIB_ALGO named in the argument */
 int main(int argc, char const *argv[])
 {
+    int mode = bn_fib_algo_find(argc > 1 ? argv[1] : "fdoubling_v0");
+    if (mode < 0 || !bn_fib_algos[mode].fib) {
+        fprintf(stderr, "usage: %s [algorithm], one of:", argv[0]);
+        for (int i = 0; i < FIB_ALGO_NR; i++) {
+            if (bn_fib_algos[i].fib)
+                fprintf(stderr, " %s", bn_fib_algos[i].name);
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    bn_init();
     bn *test = bn_alloc(1);
     for (int i = 0; i < ITER_TIMES; i++) {
-        bn_fdoubling_v0(test, ITH);
+        bn_fib_algos[mode].fib(test, ITH);
         escape(test->number);
     }
     bn_free(test);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,100 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv_ioctl.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define PAR_PARAM "/sys/module/fibdrv_bn/parameters/max_parallel"
+#define sample_size 3
+#define range_a 0
+#define range_b 20000
+#define buf_size (64 << 20)
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+static int set_max_parallel(int cpus)
+{
+    FILE *fp = fopen(PAR_PARAM, "w");
+    if (!fp)
+        return -1;
+    fprintf(fp, "%d\n", cpus);
+    return fclose(fp);
+}
+
+/* ns to get F(range_a) to F(range_b) as decimal strings by FIB_IOC_RANGE */
+static long long range(int fd, char *buf)
+{
+    struct fib_range r = {
+        .a = range_a,
+        .b = range_b,
+        .buf = (unsigned long) buf,
+        .size = buf_size,
+        .format = FIB_FMT_DEC,
+    };
+    struct timespec t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    while (r.a <= range_b) {
+        if (ioctl(fd, FIB_IOC_RANGE, &r) < 0) {
+            perror("FIB_IOC_RANGE");
+            exit(1);
+        }
+        r.a = r.next;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    return elapse(&t1, &t2);
+}
+
+/* FIB_IOC_RANGE throughput in values per second by the CPUs it may use */
+int main(int argc, char const *argv[])
+{
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_range", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+    char *buf = malloc(buf_size);
+    if (!buf) {
+        perror("malloc");
+        exit(1);
+    }
+
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    double base = 0;
+    for (int p = 1; p <= cpus; p++) {
+        if (set_max_parallel(p)) {
+            perror("Failed to set max_parallel");
+            exit(1);
+        }
+        long long best = 0;
+        for (int s = 0; s < sample_size; s++) {
+            long long t = range(fd, buf);
+            if (!best || t < best)
+                best = t;
+        }
+        double rate = (range_b - range_a + 1) * 1e9 / best;
+        if (p == 1)
+            base = rate;
+        fprintf(fp, "%d %.0f %.3f\n", p, rate, rate / base);
+        printf("%2d CPUs: %10.0f values/s x%.2f\n", p, rate, rate / base);
+    }
+    set_max_parallel(1);
+    close(fd);
+    fclose(fp);
+    free(buf);
+    return 0;
+}
@@ -8,14 +8,23 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "fibdrv_ioctl.h"
+
 #define FIB_DEV "/dev/fibonacci"
 #define sample_size 500
 #define offset 60000
-#define mode 1
+/* algorithms to time, the write() modes */
+static const int modes[] = {FIB_ALGO_FDOUBLING};
+#define MODE_NUM (sizeof(modes) / sizeof(modes[0]))
 
-int main()
+int main(int argc, char const *argv[])
 {
-    FILE *fp = fopen("./plot_bn_fd_v3_bn_mult", "w");
+    /* the output file can be overridden to compare module parameters */
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_bn_fd_v3_bn_mult", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
     char write_buf[] = "testing writing";
 
     int fd = open(FIB_DEV, O_RDWR);
@@ -29,14 +38,15 @@ int main()
      */
     for (int i = 0; i <= offset; i++) {
         lseek(fd, i, SEEK_SET);
-        double time[mode][sample_size] = {0};
-        double mean[mode] = {0.0}, sd[mode] = {0.0}, result[mode] = {0.0};
-        int count[mode] = {0};
+        double time[MODE_NUM][sample_size] = {0};
+        double mean[MODE_NUM] = {0.0}, sd[MODE_NUM] = {0.0};
+        double result[MODE_NUM] = {0.0};
+        int count[MODE_NUM] = {0};
 
-        for (int m = 0; m < mode; ++m) {
+        for (size_t m = 0; m < MODE_NUM; ++m) {
             for (int n = 0; n < sample_size; n++) { /* sampling */
                 /* get the runtime in kernel space here */
-                time[m][n] = write(fd, write_buf, m);
+                time[m][n] = write(fd, write_buf, modes[m]);
                 mean[m] += time[m][n]; /* sum */
             }
             mean[m] /= sample_size; /* mean */
@@ -58,11 +68,11 @@ int main()
 
         // print result to file
         fprintf(fp, "%d ", i);
-        for (int m = 0; m < mode; ++m) {
+        for (size_t m = 0; m < MODE_NUM; ++m) {
             fprintf(fp, "%.5lf ", result[m]);
         }
         fprintf(fp, "samples: ");
-        for (int m = 0; m < mode; ++m) {
+        for (size_t m = 0; m < MODE_NUM; ++m) {
             fprintf(fp, "%d ", count[m]);
         }
         fprintf(fp, "\n");
@@ -0,0 +1,74 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fibdrv_ioctl.h"
+
+#define FIB_DEV "/dev/fibonacci"
+#define MAX_THREADS 16
+#define reads_per_thread 2000
+#define offset 10000
+#define fib_mode FIB_ALGO_FDOUBLING
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+/* every worker opens its own fd, so it gets its own state in the driver */
+static void *worker(void *arg)
+{
+    char buf[offset];
+    long failed = 0;
+    int fd = open(FIB_DEV, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open character device");
+        exit(1);
+    }
+    __u32 mode = fib_mode;
+    ioctl(fd, FIB_IOC_SET_MODE, &mode);
+    for (int i = 0; i < reads_per_thread; i++) {
+        lseek(fd, offset - i % 100, SEEK_SET);
+        if (read(fd, buf, sizeof(buf)) <= 0)
+            failed++;
+    }
+    close(fd);
+    return (void *) failed;
+}
+
+/* aggregate fib_read throughput against the number of threads */
+int main(int argc, char const *argv[])
+{
+    pthread_t tid[MAX_THREADS];
+    FILE *fp = fopen(argc > 1 ? argv[1] : "./plot_throughput", "w");
+    if (!fp) {
+        perror("Failed to open output file");
+        exit(1);
+    }
+
+    for (int n = 1; n <= MAX_THREADS; n++) {
+        struct timespec t1, t2;
+        long failed = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        for (int i = 0; i < n; i++)
+            pthread_create(&tid[i], NULL, worker, NULL);
+        for (int i = 0; i < n; i++) {
+            void *ret;
+            pthread_join(tid[i], &ret);
+            failed += (long) ret;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+        if (failed)
+            fprintf(stderr, "%d threads: %ld reads failed\n", n, failed);
+        double sec = elapse(&t1, &t2) / 1e9;
+        fprintf(fp, "%d %.1f\n", n, (double) n * reads_per_thread / sec);
+    }
+    fclose(fp);
+    return 0;
+}
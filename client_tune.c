@@ -0,0 +1,115 @@
+#include <time.h>
+
+#include "bn.h"
+
+#define THRESHOLD_OFF 0x7fffffff
+/* a method takes over once it wins this many sizes in a row */
+#define WIN_STREAK 3
+#define sample_size 5
+/* least time per sample, so small sizes get enough iterations */
+#define sample_ns 2000000LL
+
+static long long elapse(const struct timespec *t1, const struct timespec *t2)
+{
+    return (t2->tv_sec - t1->tv_sec) * 1000000000LL +
+           (t2->tv_nsec - t1->tv_nsec);
+}
+
+static uint64_t rnd(void)
+{
+    static uint64_t x = 88172645463325252ULL;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+/* ns to multiply and square n-limb operands with the current thresholds */
+static long long measure(bn *a, bn *b, bn *c, int n)
+{
+    a->size = b->size = n;
+    long long best = 0;
+    long iter = 1;
+    for (int s = 0; s < sample_size; s++) {
+        struct timespec t1, t2;
+        long long t;
+        /* grow the iterations until a sample is long enough to time */
+        for (;;) {
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            for (long i = 0; i < iter; i++) {
+                bn_mult(a, b, c);
+                bn_sqr(a, c);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            t = elapse(&t1, &t2);
+            if (t >= sample_ns || s)
+                break;
+            iter *= 2;
+        }
+        t /= iter;
+        if (!best || t < best)
+            best = t;
+    }
+    return best;
+}
+
+/*
+ * smallest size from lo to hi at which the method behind *threshold beats
+ * the ones below it, hi if it never does
+ */
+static int tune(const char *name, int *threshold, int lo, int hi)
+{
+    int max = 2 * hi + 1;
+    bn *a = bn_alloc(max), *b = bn_alloc(max), *c = bn_alloc(2 * max);
+    for (int i = 0; i < max; i++) {
+        a->number[i] = rnd();
+        b->number[i] = rnd();
+    }
+
+    int found = hi, streak = 0;
+    for (int n = lo; n <= hi; n += n / 10 ? n / 10 : 1) {
+        /* n limbs below the threshold, then at it */
+        *threshold = n + 1;
+        long long below = measure(a, b, c, n);
+        *threshold = n;
+        long long at = measure(a, b, c, n);
+        fprintf(stderr, "%s: %6d limbs %12lld ns below, %12lld ns at\n",
+                name, n, below, at);
+        if (at < below) {
+            if (!streak++)
+                found = n;
+            if (streak == WIN_STREAK)
+                break;
+        } else {
+            streak = 0;
+        }
+    }
+    if (streak < WIN_STREAK)
+        found = hi;
+    *threshold = found;
+
+    bn_free(a);
+    bn_free(b);
+    bn_free(c);
+    return found;
+}
+
+/*
+ * find the multiplication thresholds of this machine, lowest first, each
+ * with those below it tuned and those above it off, and print them as
+ * module parameters, e.g. sudo insmod fibdrv_bn.ko $(./client_tune)
+ */
+int main(void)
+{
+    bn_init();
+    bn_toom3_threshold = THRESHOLD_OFF;
+    bn_ntt_threshold = THRESHOLD_OFF;
+
+    int kara = tune("karatsuba", &bn_karatsuba_threshold, 4, 512);
+    int toom = tune("toom3", &bn_toom3_threshold, kara, 8192);
+    int ntt = tune("ntt", &bn_ntt_threshold, toom, 1 << 17);
+
+    printf("karatsuba_threshold=%d toom3_threshold=%d ntt_threshold=%d\n",
+           kara, toom, ntt);
+    return 0;
+}
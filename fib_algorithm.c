@@ -1,10 +1,15 @@
+#include <linux/compiler.h>
+
+#include "bn_kernel.h"
 #include "fib_algorithm.h"
 
 uint64_t fib_sequence(long long k)
 {
+    if ((unsigned long long) k <= BN_FIB_U64_MAX)
+        return bn_fib_u64(k);
     uint64_t state[] = {0, 1};
 
-    for (int i = 2; i <= k; i++) {
+    for (long long i = 2; i <= k && !bn_fib_yield(i); i++) {
         state[(i & 1)] += state[((i - 1) & 1)];
     }
 
@@ -13,12 +18,14 @@ uint64_t fib_sequence(long long k)
 
 uint64_t fib_fast_doubling(long long k)
 {
+    if ((unsigned long long) k <= BN_FIB_U64_MAX)
+        return bn_fib_u64(k);
     if (k < 2)
         return k;
     uint64_t f1 = 0;  // F(0) = 0
     uint64_t f2 = 1;  // F(1) = 1
 
-    for (unsigned int mask = 1U << (31 - __builtin_clz(k)); mask; mask >>= 1) {
+    for (uint64_t mask = 1ULL << (63 - __builtin_clzll(k)); mask; mask >>= 1) {
         uint64_t k1 = f1 * ((f2 << 1) - f1);  // F(2k) = F(k)*[2*F(k+1) – F(k)]
         uint64_t k2 = f1 * f1 + f2 * f2;      // F(2k+1) = F(k)^2 + F(k+1)^2
 
@@ -31,4 +38,87 @@ uint64_t fib_fast_doubling(long long k)
         }
     }
     return f1;
-}
\ No newline at end of file
+}
+
+/* a * b mod m, a and b below m */
+static uint64_t mulmod(uint64_t a, uint64_t b, uint64_t m)
+{
+#if BN_WSIZE == 64
+    bn_data hi, lo = bn_mul_limb(a, b, &hi), r;
+    bn_div_limb(hi, lo, m, &r);  // hi < m as a * b < m^2
+    return r;
+#else
+    uint64_t r = 0;
+    for (; b; b >>= 1) {
+        if (b & 1)
+            r = r >= m - a ? r - (m - a) : r + a;
+        a = a >= m - a ? a - (m - a) : a + a;
+    }
+    return r;
+#endif
+}
+
+/* a + b mod m, a and b below m */
+static uint64_t addmod(uint64_t a, uint64_t b, uint64_t m)
+{
+    return a >= m - b ? a - (m - b) : a + b;
+}
+
+/* a - b mod m, a and b below m */
+static uint64_t submod(uint64_t a, uint64_t b, uint64_t m)
+{
+    return a >= b ? a - b : a + (m - b);
+}
+
+/*
+ * pi(m), the period of F(k) mod m, found by walking the sequence until
+ * 0, 1 comes back, pi(m) <= 6m
+ */
+static uint32_t fib_pisano(uint32_t m)
+{
+    uint32_t a = 0, b = 1 % m, p = 0;
+    do {
+        uint32_t t = a >= m - b ? a - (m - b) : a + b;
+        a = b;
+        b = t;
+        p++;
+    } while (a || b != 1 % m);
+    return p;
+}
+
+/* pi(m) of each m up to FIB_PISANO_M_MAX, 0 until first asked for */
+static uint16_t fib_pisano_cache[FIB_PISANO_M_MAX + 1];
+
+uint64_t fib_fast_doubling_mod(uint64_t k, uint64_t m)
+{
+    /* a small m repeats within 6m, so k shrinks to a few doubling steps */
+    if (m <= FIB_PISANO_M_MAX) {
+        uint16_t p = READ_ONCE(fib_pisano_cache[m]);
+        if (!p) {
+            p = fib_pisano(m);
+            WRITE_ONCE(fib_pisano_cache[m], p);
+        }
+        k %= p;
+    }
+    if (k <= BN_FIB_U64_MAX)
+        return bn_fib_u64(k) % m;
+    uint64_t f1 = 0;      // F(0) = 0
+    uint64_t f2 = 1 % m;  // F(1) = 1
+
+    for (uint64_t mask = k ? 1ULL << (63 - __builtin_clzll(k)) : 0; mask;
+         mask >>= 1) {
+        /* F(2k) = F(k)*[2*F(k+1) – F(k)] */
+        uint64_t k1 = mulmod(f1, submod(addmod(f2, f2, m), f1, m), m);
+        /* F(2k+1) = F(k)^2 + F(k+1)^2 */
+        uint64_t k2 = addmod(mulmod(f1, f1, m), mulmod(f2, f2, m), m);
+
+        if (mask & k) {
+            f1 = k2;
+            f2 = addmod(k1, k2, m);
+        } else {
+            f1 = k1;
+            f2 = k2;
+        }
+    }
+    return f1;
+}
@@ -1,4 +1,17 @@
 #include <linux/types.h>
 
+/*
+ * F(k) on u64, wrapping past F(93); k up to BN_FIB_U64_MAX is looked up
+ * in a table
+ */
 uint64_t fib_sequence(long long k);
-uint64_t fib_fast_doubling(long long k);
\ No newline at end of file
+uint64_t fib_fast_doubling(long long k);
+
+/* moduli up to this have k reduced by their Pisano period first */
+#define FIB_PISANO_M_MAX 1024
+
+/*
+ * F(k) mod m by fast doubling on 64-bit residues, m > 0, for any k in
+ * 64 steps at most, 13 for m up to FIB_PISANO_M_MAX
+ */
+uint64_t fib_fast_doubling_mod(uint64_t k, uint64_t m);
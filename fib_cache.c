@@ -0,0 +1,172 @@
+#include <linux/debugfs.h>
+#include <linux/hashtable.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "fib_cache.h"
+
+/* bytes the cached entries may take, 0 disables the cache */
+static unsigned long fib_cache_budget = 16 << 20;
+module_param_named(cache_budget, fib_cache_budget, ulong, 0644);
+MODULE_PARM_DESC(cache_budget, "bytes of F(n) results cached, 0 disables");
+
+#define FIB_CACHE_HASH_BITS 10
+
+/* lock protects the hash, the LRU list and the statistics below */
+static DEFINE_SPINLOCK(fib_cache_lock);
+static DEFINE_HASHTABLE(fib_cache_hash, FIB_CACHE_HASH_BITS);
+static LIST_HEAD(fib_cache_lru);
+
+static size_t fib_cache_bytes;
+static u64 fib_cache_hits, fib_cache_misses, fib_cache_evictions;
+static struct dentry *fib_cache_dir;
+
+static void fib_cache_release(struct kref *ref)
+{
+    struct fib_cache_entry *e = container_of(ref, struct fib_cache_entry, ref);
+    bn_free(e->fib);
+    kvfree(e->str);
+    kfree(e);
+}
+
+void fib_cache_put(struct fib_cache_entry *e)
+{
+    kref_put(&e->ref, fib_cache_release);
+}
+
+/*
+ * unlink the least recently used entries until bytes more fit the budget
+ * the cache references of the victims are moved to the victims list
+ */
+static void fib_cache_evict(size_t bytes, struct list_head *victims)
+{
+    while (!list_empty(&fib_cache_lru) &&
+           fib_cache_bytes + bytes > fib_cache_budget) {
+        struct fib_cache_entry *e =
+            list_last_entry(&fib_cache_lru, struct fib_cache_entry, lru);
+        hash_del(&e->node);
+        list_move(&e->lru, victims);
+        fib_cache_bytes -= e->bytes;
+        fib_cache_evictions++;
+    }
+}
+
+static void fib_cache_put_all(struct list_head *victims)
+{
+    struct fib_cache_entry *e, *tmp;
+    list_for_each_entry_safe(e, tmp, victims, lru)
+        fib_cache_put(e);
+}
+
+/* find F(n) in the hash, with fib_cache_lock held */
+static struct fib_cache_entry *fib_cache_lookup(uint64_t n)
+{
+    struct fib_cache_entry *e;
+    hash_for_each_possible(fib_cache_hash, e, node, n)
+    {
+        if (e->n == n)
+            return e;
+    }
+    return NULL;
+}
+
+struct fib_cache_entry *fib_cache_get(uint64_t n)
+{
+    struct fib_cache_entry *e;
+
+    spin_lock(&fib_cache_lock);
+    e = fib_cache_lookup(n);
+    if (e) {
+        kref_get(&e->ref);
+        list_move(&e->lru, &fib_cache_lru);
+        fib_cache_hits++;
+    } else {
+        fib_cache_misses++;
+    }
+    spin_unlock(&fib_cache_lock);
+    return e;
+}
+
+struct fib_cache_entry *fib_cache_insert(uint64_t n,
+                                         const bn *fib,
+                                         char *str)
+{
+    struct fib_cache_entry *e, *old;
+    LIST_HEAD(victims);
+    size_t bytes = sizeof(*e) + sizeof(bn) + sizeof(bn_data) * fib->size +
+                   strlen(str) + 1;
+
+    if (bytes > READ_ONCE(fib_cache_budget))
+        return NULL;
+
+    /* copy outside the lock, the result is dropped if we lose a race */
+    e = kmalloc(sizeof(*e), GFP_KERNEL);
+    if (!e)
+        return NULL;
+    e->fib = bn_alloc(fib->size);
+    if (!e->fib || bn_cpy(e->fib, (bn *) fib) < 0) {
+        bn_free(e->fib);
+        kfree(e);
+        return NULL;
+    }
+    e->n = n;
+    e->str = str;
+    e->bytes = bytes;
+    kref_init(&e->ref); /* the reference of the cache */
+
+    spin_lock(&fib_cache_lock);
+    old = fib_cache_lookup(n);
+    if (old) {
+        kref_get(&old->ref);
+        spin_unlock(&fib_cache_lock);
+        fib_cache_put(e);
+        return old;
+    }
+    fib_cache_evict(bytes, &victims);
+    hash_add(fib_cache_hash, &e->node, n);
+    list_add(&e->lru, &fib_cache_lru);
+    fib_cache_bytes += bytes;
+    kref_get(&e->ref); /* the reference of the caller */
+    spin_unlock(&fib_cache_lock);
+
+    fib_cache_put_all(&victims);
+    return e;
+}
+
+int fib_cache_init(void)
+{
+    /* statistics only, a missing debugfs does not stop the driver */
+    fib_cache_dir = debugfs_create_dir("fibonacci", NULL);
+    debugfs_create_u64("cache_hits", 0444, fib_cache_dir, &fib_cache_hits);
+    debugfs_create_u64("cache_misses", 0444, fib_cache_dir,
+                       &fib_cache_misses);
+    debugfs_create_u64("cache_evictions", 0444, fib_cache_dir,
+                       &fib_cache_evictions);
+    debugfs_create_size_t("cache_bytes", 0444, fib_cache_dir,
+                          &fib_cache_bytes);
+    return 0;
+}
+
+void fib_cache_exit(void)
+{
+    struct fib_cache_entry *e;
+    struct hlist_node *tmp;
+    LIST_HEAD(victims);
+    int bkt;
+
+    debugfs_remove_recursive(fib_cache_dir);
+
+    spin_lock(&fib_cache_lock);
+    hash_for_each_safe(fib_cache_hash, bkt, tmp, e, node)
+    {
+        hash_del(&e->node);
+        list_move(&e->lru, &victims);
+    }
+    fib_cache_bytes = 0;
+    spin_unlock(&fib_cache_lock);
+
+    fib_cache_put_all(&victims);
+}
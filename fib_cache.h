@@ -0,0 +1,46 @@
+#ifndef FIB_CACHE_H
+#define FIB_CACHE_H
+
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/types.h>
+
+#include "bn_kernel.h"
+
+/*
+ * a cached F(n), shared by every reader holding a reference
+ * fib and str are immutable once the entry is published
+ */
+struct fib_cache_entry {
+    struct hlist_node node; /* in the hash keyed by n */
+    struct list_head lru;   /* most recently used first */
+    struct kref ref;
+    uint64_t n;
+    bn *fib;
+    char *str;    /* decimal string of fib */
+    size_t bytes; /* charged against the cache budget */
+};
+
+int fib_cache_init(void);
+void fib_cache_exit(void);
+
+/*
+ * look up F(n)
+ * return a referenced entry on hit, NULL on miss
+ */
+struct fib_cache_entry *fib_cache_get(uint64_t n);
+
+/*
+ * publish F(n) = fib with its decimal string str
+ * fib is copied, str is taken over by the cache unless NULL is returned
+ * return a referenced entry, possibly inserted by a concurrent reader,
+ * or NULL if the cache is disabled or out of memory
+ */
+struct fib_cache_entry *fib_cache_insert(uint64_t n,
+                                         const bn *fib,
+                                         char *str);
+
+/* drop a reference taken by fib_cache_get() or fib_cache_insert() */
+void fib_cache_put(struct fib_cache_entry *e);
+
+#endif /* FIB_CACHE_H */
@@ -0,0 +1,112 @@
+#include <linux/hashtable.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#include "fib_checkpoint.h"
+
+/*
+ * checkpoints are kept for n up to this, for the default that is about
+ * 100 pairs and 1 MiB, the memory grows with its square
+ */
+static unsigned long long fib_ckpt_max_n = 100000;
+module_param_named(ckpt_max_n, fib_ckpt_max_n, ullong, 0644);
+MODULE_PARM_DESC(ckpt_max_n, "largest n resumed from a checkpoint");
+
+/*
+ * checkpoints are published once and never change or go away before
+ * fib_ckpt_exit(), so readers use them without holding the lock
+ */
+struct fib_ckpt {
+    struct hlist_node node;
+    uint64_t k;
+    bn *f0; /* F(k) */
+    bn *f1; /* F(k+1) */
+};
+
+static DEFINE_SPINLOCK(fib_ckpt_lock);
+static DEFINE_HASHTABLE(fib_ckpt_hash, 8);
+
+/* find the checkpoint at k, with fib_ckpt_lock held */
+static struct fib_ckpt *fib_ckpt_lookup(uint64_t k)
+{
+    struct fib_ckpt *c;
+    hash_for_each_possible(fib_ckpt_hash, c, node, k)
+    {
+        if (c->k == k)
+            return c;
+    }
+    return NULL;
+}
+
+static void fib_ckpt_free(struct fib_ckpt *c)
+{
+    bn_free(c->f0);
+    bn_free(c->f1);
+    kfree(c);
+}
+
+/* the checkpoint at k, computed and published on first use */
+static const struct fib_ckpt *fib_ckpt_get(uint64_t k)
+{
+    struct fib_ckpt *c, *old;
+
+    spin_lock(&fib_ckpt_lock);
+    c = fib_ckpt_lookup(k);
+    spin_unlock(&fib_ckpt_lock);
+    if (c)
+        return c;
+
+    /* kept on the heap, it outlives the arena of the reader */
+    c = kzalloc(sizeof(*c), GFP_KERNEL);
+    if (!c)
+        return NULL;
+    c->k = k;
+    c->f0 = bn_alloc(1);
+    c->f1 = bn_alloc(1);
+    if (!c->f0 || !c->f1) {
+        fib_ckpt_free(c);
+        return NULL;
+    }
+    bn_fdoubling_pair(c->f0, c->f1, k);
+
+    /* a concurrent reader may have published the same checkpoint */
+    spin_lock(&fib_ckpt_lock);
+    old = fib_ckpt_lookup(k);
+    if (!old)
+        hash_add(fib_ckpt_hash, &c->node, k);
+    spin_unlock(&fib_ckpt_lock);
+    if (old) {
+        fib_ckpt_free(c);
+        return old;
+    }
+    return c;
+}
+
+void fib_ckpt_fib(bn *dest, uint64_t n)
+{
+    uint64_t k = n & ~(uint64_t) (FIB_CKPT_STRIDE - 1);
+    const struct fib_ckpt *c = NULL;
+
+    if (n <= READ_ONCE(fib_ckpt_max_n))
+        c = fib_ckpt_get(k);
+
+    if (!c) {
+        bn_fdoubling_v1(dest, n);
+        return;
+    }
+    bn_fib_resume(dest, c->f0, c->f1, n - k);
+}
+
+void fib_ckpt_exit(void)
+{
+    struct fib_ckpt *c;
+    struct hlist_node *tmp;
+    int bkt;
+
+    hash_for_each_safe(fib_ckpt_hash, bkt, tmp, c, node)
+    {
+        hash_del(&c->node);
+        fib_ckpt_free(c);
+    }
+}
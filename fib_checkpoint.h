@@ -0,0 +1,21 @@
+#ifndef FIB_CHECKPOINT_H
+#define FIB_CHECKPOINT_H
+
+#include "bn_kernel.h"
+
+/* (F(k), F(k+1)) is kept for every k that is a multiple of the stride */
+#define FIB_CKPT_SHIFT 10
+#define FIB_CKPT_STRIDE (1U << FIB_CKPT_SHIFT)
+
+/*
+ * dest = F(n), resumed from the checkpoint at or below n
+ * the checkpoint is computed and kept on first use, n above the
+ * ckpt_max_n module parameter is computed from scratch instead
+ * temporaries are taken from the arena of dest
+ */
+void fib_ckpt_fib(bn *dest, uint64_t n);
+
+/* free every checkpoint */
+void fib_ckpt_exit(void);
+
+#endif /* FIB_CHECKPOINT_H */
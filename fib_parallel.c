@@ -0,0 +1,105 @@
+#include <linux/atomic.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "bn_kernel.h"
+#include "fib_parallel.h"
+
+static struct workqueue_struct *fib_par_wq;
+
+/*
+ * helpers at work for all opens together, at most bn_par_max - 1 since
+ * every caller works as well
+ */
+static atomic_t fib_par_busy = ATOMIC_INIT(0);
+
+/* the calls of one bn_par_run, taken by index by whoever is free */
+struct fib_par_job {
+    bn_par_fn fn;
+    void *arg;
+    int n;
+    atomic_t next;
+};
+
+struct fib_par_work {
+    struct work_struct work;
+    struct fib_par_job *job;
+};
+
+static void fib_par_drain(struct fib_par_job *job)
+{
+    int i;
+    while ((i = atomic_inc_return(&job->next) - 1) < job->n)
+        job->fn(job->arg, i);
+}
+
+static void fib_par_work_fn(struct work_struct *work)
+{
+    struct fib_par_work *w = container_of(work, struct fib_par_work, work);
+    fib_par_drain(w->job);
+    atomic_dec(&fib_par_busy);
+}
+
+/* take up to want helpers, return how many were free */
+static int fib_par_take(int want)
+{
+    int max = READ_ONCE(bn_par_max) - 1;
+    int busy = atomic_read(&fib_par_busy);
+    for (;;) {
+        int got = min(want, max - busy);
+        if (got <= 0)
+            return 0;
+        int old = atomic_cmpxchg(&fib_par_busy, busy, busy + got);
+        if (old == busy)
+            return got;
+        busy = old;
+    }
+}
+
+/*
+ * queue as many helpers as are free and work through the calls along
+ * with them, a helper that finds none left quits at once
+ * nothing waits for a helper to become free, so the nested calls of an
+ * NTT inside a fast doubling step cannot deadlock
+ */
+void fib_par_run(bn_par_fn fn, void *arg, int n)
+{
+    struct fib_par_job job = {.fn = fn, .arg = arg, .n = n};
+    struct fib_par_work *w = NULL;
+    int helpers = fib_par_take(n - 1);
+
+    if (helpers) {
+        w = kmalloc_array(helpers, sizeof(*w), GFP_KERNEL);
+        if (!w) {
+            atomic_sub(helpers, &fib_par_busy);
+            helpers = 0;
+        }
+    }
+    atomic_set(&job.next, 0);
+    for (int i = 0; i < helpers; i++) {
+        w[i].job = &job;
+        INIT_WORK(&w[i].work, fib_par_work_fn);
+        queue_work(fib_par_wq, &w[i].work);
+    }
+    fib_par_drain(&job);
+    for (int i = 0; i < helpers; i++)
+        flush_work(&w[i].work);
+    kfree(w);
+}
+
+int fib_par_init(void)
+{
+    /* unbound, so that the scheduler spreads the helpers over CPUs */
+    fib_par_wq = alloc_workqueue("fibdrv_par", WQ_UNBOUND, 0);
+    if (!fib_par_wq)
+        return -ENOMEM;
+    bn_par_run = fib_par_run;
+    return 0;
+}
+
+void fib_par_exit(void)
+{
+    bn_par_run = NULL;
+    destroy_workqueue(fib_par_wq);
+}
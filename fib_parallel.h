@@ -0,0 +1,23 @@
+#ifndef FIB_PARALLEL_H
+#define FIB_PARALLEL_H
+
+#include "bn_kernel.h"
+
+/*
+ * plug a workqueue into bn_par_run, so that large multiplies spread over
+ * up to max_parallel CPUs
+ * return 0 on success, -ENOMEM on error
+ */
+int fib_par_init(void);
+
+/*
+ * run fn(arg, 0) to fn(arg, n - 1) on the calling thread and as many
+ * workqueue helpers as max_parallel still allows, and return when all
+ * are done; this is bn_par_run once fib_par_init() succeeded
+ */
+void fib_par_run(bn_par_fn fn, void *arg, int n);
+
+/* unplug and drain the workqueue */
+void fib_par_exit(void);
+
+#endif /* FIB_PARALLEL_H */
@@ -0,0 +1,200 @@
+/* generated by scripts/gen-fib-table.py, do not edit */
+#ifndef FIB_TABLE_H
+#define FIB_TABLE_H
+
+/* largest n with F(n) below 2^128, and below 2^64 */
+#define FIB_TABLE_MAX 186
+#define FIB_TABLE_U64_MAX 93
+
+/* F(n) as its low and high 64 bits */
+static const uint64_t fib_table[FIB_TABLE_MAX + 1][2] = {
+    {0x0000000000000000, 0x0000000000000000}, /* 0 */
+    {0x0000000000000001, 0x0000000000000000}, /* 1 */
+    {0x0000000000000001, 0x0000000000000000}, /* 2 */
+    {0x0000000000000002, 0x0000000000000000}, /* 3 */
+    {0x0000000000000003, 0x0000000000000000}, /* 4 */
+    {0x0000000000000005, 0x0000000000000000}, /* 5 */
+    {0x0000000000000008, 0x0000000000000000}, /* 6 */
+    {0x000000000000000d, 0x0000000000000000}, /* 7 */
+    {0x0000000000000015, 0x0000000000000000}, /* 8 */
+    {0x0000000000000022, 0x0000000000000000}, /* 9 */
+    {0x0000000000000037, 0x0000000000000000}, /* 10 */
+    {0x0000000000000059, 0x0000000000000000}, /* 11 */
+    {0x0000000000000090, 0x0000000000000000}, /* 12 */
+    {0x00000000000000e9, 0x0000000000000000}, /* 13 */
+    {0x0000000000000179, 0x0000000000000000}, /* 14 */
+    {0x0000000000000262, 0x0000000000000000}, /* 15 */
+    {0x00000000000003db, 0x0000000000000000}, /* 16 */
+    {0x000000000000063d, 0x0000000000000000}, /* 17 */
+    {0x0000000000000a18, 0x0000000000000000}, /* 18 */
+    {0x0000000000001055, 0x0000000000000000}, /* 19 */
+    {0x0000000000001a6d, 0x0000000000000000}, /* 20 */
+    {0x0000000000002ac2, 0x0000000000000000}, /* 21 */
+    {0x000000000000452f, 0x0000000000000000}, /* 22 */
+    {0x0000000000006ff1, 0x0000000000000000}, /* 23 */
+    {0x000000000000b520, 0x0000000000000000}, /* 24 */
+    {0x0000000000012511, 0x0000000000000000}, /* 25 */
+    {0x000000000001da31, 0x0000000000000000}, /* 26 */
+    {0x000000000002ff42, 0x0000000000000000}, /* 27 */
+    {0x000000000004d973, 0x0000000000000000}, /* 28 */
+    {0x000000000007d8b5, 0x0000000000000000}, /* 29 */
+    {0x00000000000cb228, 0x0000000000000000}, /* 30 */
+    {0x0000000000148add, 0x0000000000000000}, /* 31 */
+    {0x0000000000213d05, 0x0000000000000000}, /* 32 */
+    {0x000000000035c7e2, 0x0000000000000000}, /* 33 */
+    {0x00000000005704e7, 0x0000000000000000}, /* 34 */
+    {0x00000000008cccc9, 0x0000000000000000}, /* 35 */
+    {0x0000000000e3d1b0, 0x0000000000000000}, /* 36 */
+    {0x0000000001709e79, 0x0000000000000000}, /* 37 */
+    {0x0000000002547029, 0x0000000000000000}, /* 38 */
+    {0x0000000003c50ea2, 0x0000000000000000}, /* 39 */
+    {0x0000000006197ecb, 0x0000000000000000}, /* 40 */
+    {0x0000000009de8d6d, 0x0000000000000000}, /* 41 */
+    {0x000000000ff80c38, 0x0000000000000000}, /* 42 */
+    {0x0000000019d699a5, 0x0000000000000000}, /* 43 */
+    {0x0000000029cea5dd, 0x0000000000000000}, /* 44 */
+    {0x0000000043a53f82, 0x0000000000000000}, /* 45 */
+    {0x000000006d73e55f, 0x0000000000000000}, /* 46 */
+    {0x00000000b11924e1, 0x0000000000000000}, /* 47 */
+    {0x000000011e8d0a40, 0x0000000000000000}, /* 48 */
+    {0x00000001cfa62f21, 0x0000000000000000}, /* 49 */
+    {0x00000002ee333961, 0x0000000000000000}, /* 50 */
+    {0x00000004bdd96882, 0x0000000000000000}, /* 51 */
+    {0x00000007ac0ca1e3, 0x0000000000000000}, /* 52 */
+    {0x0000000c69e60a65, 0x0000000000000000}, /* 53 */
+    {0x0000001415f2ac48, 0x0000000000000000}, /* 54 */
+    {0x000000207fd8b6ad, 0x0000000000000000}, /* 55 */
+    {0x0000003495cb62f5, 0x0000000000000000}, /* 56 */
+    {0x0000005515a419a2, 0x0000000000000000}, /* 57 */
+    {0x00000089ab6f7c97, 0x0000000000000000}, /* 58 */
+    {0x000000dec1139639, 0x0000000000000000}, /* 59 */
+    {0x000001686c8312d0, 0x0000000000000000}, /* 60 */
+    {0x000002472d96a909, 0x0000000000000000}, /* 61 */
+    {0x000003af9a19bbd9, 0x0000000000000000}, /* 62 */
+    {0x000005f6c7b064e2, 0x0000000000000000}, /* 63 */
+    {0x000009a661ca20bb, 0x0000000000000000}, /* 64 */
+    {0x00000f9d297a859d, 0x0000000000000000}, /* 65 */
+    {0x000019438b44a658, 0x0000000000000000}, /* 66 */
+    {0x000028e0b4bf2bf5, 0x0000000000000000}, /* 67 */
+    {0x000042244003d24d, 0x0000000000000000}, /* 68 */
+    {0x00006b04f4c2fe42, 0x0000000000000000}, /* 69 */
+    {0x0000ad2934c6d08f, 0x0000000000000000}, /* 70 */
+    {0x0001182e2989ced1, 0x0000000000000000}, /* 71 */
+    {0x0001c5575e509f60, 0x0000000000000000}, /* 72 */
+    {0x0002dd8587da6e31, 0x0000000000000000}, /* 73 */
+    {0x0004a2dce62b0d91, 0x0000000000000000}, /* 74 */
+    {0x000780626e057bc2, 0x0000000000000000}, /* 75 */
+    {0x000c233f54308953, 0x0000000000000000}, /* 76 */
+    {0x0013a3a1c2360515, 0x0000000000000000}, /* 77 */
+    {0x001fc6e116668e68, 0x0000000000000000}, /* 78 */
+    {0x00336a82d89c937d, 0x0000000000000000}, /* 79 */
+    {0x00533163ef0321e5, 0x0000000000000000}, /* 80 */
+    {0x00869be6c79fb562, 0x0000000000000000}, /* 81 */
+    {0x00d9cd4ab6a2d747, 0x0000000000000000}, /* 82 */
+    {0x016069317e428ca9, 0x0000000000000000}, /* 83 */
+    {0x023a367c34e563f0, 0x0000000000000000}, /* 84 */
+    {0x039a9fadb327f099, 0x0000000000000000}, /* 85 */
+    {0x05d4d629e80d5489, 0x0000000000000000}, /* 86 */
+    {0x096f75d79b354522, 0x0000000000000000}, /* 87 */
+    {0x0f444c01834299ab, 0x0000000000000000}, /* 88 */
+    {0x18b3c1d91e77decd, 0x0000000000000000}, /* 89 */
+    {0x27f80ddaa1ba7878, 0x0000000000000000}, /* 90 */
+    {0x40abcfb3c0325745, 0x0000000000000000}, /* 91 */
+    {0x68a3dd8e61eccfbd, 0x0000000000000000}, /* 92 */
+    {0xa94fad42221f2702, 0x0000000000000000}, /* 93 */
+    {0x11f38ad0840bf6bf, 0x0000000000000001}, /* 94 */
+    {0xbb433812a62b1dc1, 0x0000000000000001}, /* 95 */
+    {0xcd36c2e32a371480, 0x0000000000000002}, /* 96 */
+    {0x8879faf5d0623241, 0x0000000000000004}, /* 97 */
+    {0x55b0bdd8fa9946c1, 0x0000000000000007}, /* 98 */
+    {0xde2ab8cecafb7902, 0x000000000000000b}, /* 99 */
+    {0x33db76a7c594bfc3, 0x0000000000000013}, /* 100 */
+    {0x12062f76909038c5, 0x000000000000001f}, /* 101 */
+    {0x45e1a61e5624f888, 0x0000000000000032}, /* 102 */
+    {0x57e7d594e6b5314d, 0x0000000000000051}, /* 103 */
+    {0x9dc97bb33cda29d5, 0x0000000000000083}, /* 104 */
+    {0xf5b15148238f5b22, 0x00000000000000d4}, /* 105 */
+    {0x937accfb606984f7, 0x0000000000000158}, /* 106 */
+    {0x892c1e4383f8e019, 0x000000000000022d}, /* 107 */
+    {0x1ca6eb3ee4626510, 0x0000000000000386}, /* 108 */
+    {0xa5d30982685b4529, 0x00000000000005b3}, /* 109 */
+    {0xc279f4c14cbdaa39, 0x0000000000000939}, /* 110 */
+    {0x684cfe43b518ef62, 0x0000000000000eed}, /* 111 */
+    {0x2ac6f30501d6999b, 0x0000000000001827}, /* 112 */
+    {0x9313f148b6ef88fd, 0x0000000000002714}, /* 113 */
+    {0xbddae44db8c62298, 0x0000000000003f3b}, /* 114 */
+    {0x50eed5966fb5ab95, 0x0000000000006650}, /* 115 */
+    {0x0ec9b9e4287bce2d, 0x000000000000a58c}, /* 116 */
+    {0x5fb88f7a983179c2, 0x0000000000010bdc}, /* 117 */
+    {0x6e82495ec0ad47ef, 0x000000000001b168}, /* 118 */
+    {0xce3ad8d958dec1b1, 0x000000000002bd44}, /* 119 */
+    {0x3cbd2238198c09a0, 0x0000000000046ead}, /* 120 */
+    {0x0af7fb11726acb51, 0x0000000000072bf2}, /* 121 */
+    {0x47b51d498bf6d4f1, 0x00000000000b9a9f}, /* 122 */
+    {0x52ad185afe61a042, 0x000000000012c691}, /* 123 */
+    {0x9a6235a48a587533, 0x00000000001e6130}, /* 124 */
+    {0xed0f4dff88ba1575, 0x00000000003127c1}, /* 125 */
+    {0x877183a413128aa8, 0x00000000004f88f2}, /* 126 */
+    {0x7480d1a39bcca01d, 0x000000000080b0b4}, /* 127 */
+    {0xfbf25547aedf2ac5, 0x0000000000d039a6}, /* 128 */
+    {0x707326eb4aabcae2, 0x000000000150ea5b}, /* 129 */
+    {0x6c657c32f98af5a7, 0x0000000002212402}, /* 130 */
+    {0xdcd8a31e4436c089, 0x0000000003720e5d}, /* 131 */
+    {0x493e1f513dc1b630, 0x0000000005933260}, /* 132 */
+    {0x2616c26f81f876b9, 0x00000000090540be}, /* 133 */
+    {0x6f54e1c0bfba2ce9, 0x000000000e98731e}, /* 134 */
+    {0x956ba43041b2a3a2, 0x00000000179db3dc}, /* 135 */
+    {0x04c085f1016cd08b, 0x00000000263626fb}, /* 136 */
+    {0x9a2c2a21431f742d, 0x000000003dd3dad7}, /* 137 */
+    {0x9eecb012448c44b8, 0x00000000640a01d2}, /* 138 */
+    {0x3918da3387abb8e5, 0x00000000a1dddcaa}, /* 139 */
+    {0xd8058a45cc37fd9d, 0x0000000105e7de7c}, /* 140 */
+    {0x111e647953e3b682, 0x00000001a7c5bb27}, /* 141 */
+    {0xe923eebf201bb41f, 0x00000002adad99a3}, /* 142 */
+    {0xfa42533873ff6aa1, 0x00000004557354ca}, /* 143 */
+    {0xe36641f7941b1ec0, 0x000000070320ee6e}, /* 144 */
+    {0xdda89530081a8961, 0x0000000b58944339}, /* 145 */
+    {0xc10ed7279c35a821, 0x000000125bb531a8}, /* 146 */
+    {0x9eb76c57a4503182, 0x0000001db44974e2}, /* 147 */
+    {0x5fc6437f4085d9a3, 0x000000300ffea68b}, /* 148 */
+    {0xfe7dafd6e4d60b25, 0x0000004dc4481b6d}, /* 149 */
+    {0x5e43f356255be4c8, 0x0000007dd446c1f9}, /* 150 */
+    {0x5cc1a32d0a31efed, 0x000000cb988edd67}, /* 151 */
+    {0xbb0596832f8dd4b5, 0x000001496cd59f60}, /* 152 */
+    {0x17c739b039bfc4a2, 0x0000021505647cc8}, /* 153 */
+    {0xd2ccd033694d9957, 0x0000035e723a1c28}, /* 154 */
+    {0xea9409e3a30d5df9, 0x00000573779e98f0}, /* 155 */
+    {0xbd60da170c5af750, 0x000008d1e9d8b519}, /* 156 */
+    {0xa7f4e3faaf685549, 0x00000e4561774e0a}, /* 157 */
+    {0x6555be11bbc34c99, 0x000017174b500324}, /* 158 */
+    {0x0d4aa20c6b2ba1e2, 0x0000255cacc7512f}, /* 159 */
+    {0x72a0601e26eeee7b, 0x00003c73f8175453}, /* 160 */
+    {0x7feb022a921a905d, 0x000061d0a4dea582}, /* 161 */
+    {0xf28b6248b9097ed8, 0x00009e449cf5f9d5}, /* 162 */
+    {0x727664734b240f35, 0x0001001541d49f58}, /* 163 */
+    {0x6501c6bc042d8e0d, 0x00019e59deca992e}, /* 164 */
+    {0xd7782b2f4f519d42, 0x00029e6f209f3886}, /* 165 */
+    {0x3c79f1eb537f2b4f, 0x00043cc8ff69d1b5}, /* 166 */
+    {0x13f21d1aa2d0c891, 0x0006db3820090a3c}, /* 167 */
+    {0x506c0f05f64ff3e0, 0x000b18011f72dbf1}, /* 168 */
+    {0x645e2c209920bc71, 0x0011f3393f7be62d}, /* 169 */
+    {0xb4ca3b268f70b051, 0x001d0b3a5eeec21e}, /* 170 */
+    {0x1928674728916cc2, 0x002efe739e6aa84c}, /* 171 */
+    {0xcdf2a26db8021d13, 0x004c09adfd596a6a}, /* 172 */
+    {0xe71b09b4e09389d5, 0x007b08219bc412b6}, /* 173 */
+    {0xb50dac229895a6e8, 0x00c711cf991d7d21}, /* 174 */
+    {0x9c28b5d7792930bd, 0x014219f134e18fd8}, /* 175 */
+    {0x513661fa11bed7a5, 0x02092bc0cdff0cfa}, /* 176 */
+    {0xed5f17d18ae80862, 0x034b45b202e09cd2}, /* 177 */
+    {0x3e9579cb9ca6e007, 0x05547172d0dfa9cd}, /* 178 */
+    {0x2bf4919d278ee869, 0x089fb724d3c046a0}, /* 179 */
+    {0x6a8a0b68c435c870, 0x0df42897a49ff06d}, /* 180 */
+    {0x967e9d05ebc4b0d9, 0x1693dfbc7860370d}, /* 181 */
+    {0x0108a86eaffa7949, 0x248808541d00277b}, /* 182 */
+    {0x978745749bbf2a22, 0x3b1be81095605e88}, /* 183 */
+    {0x988fede34bb9a36b, 0x5fa3f064b2608603}, /* 184 */
+    {0x30173357e778cd8d, 0x9abfd87547c0e48c}, /* 185 */
+    {0xc8a7213b333270f8, 0xfa63c8d9fa216a8f}, /* 186 */
+};
+
+#endif /* FIB_TABLE_H */
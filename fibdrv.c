@@ -6,11 +6,19 @@
 #include <linux/kernel.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
+#include <linux/sched/signal.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>  // Required for the copy_to_user()
+#include <linux/version.h>
+#include <linux/vmalloc.h>
 
+#include "bn_dec_kernel.h"
 #include "bn_kernel.h"
 #include "fib_algorithm.h"
+#include "fib_cache.h"
+#include "fib_checkpoint.h"
+#include "fib_parallel.h"
+#include "fibdrv_ioctl.h"
 
 MODULE_LICENSE("Dual MIT/GPL");
 MODULE_AUTHOR("National Cheng Kung University, Taiwan");
@@ -19,6 +27,30 @@ MODULE_VERSION("0.1");
 
 #define DEV_FIBONACCI_NAME "fibonacci"
 
+module_param_named(karatsuba_threshold, bn_karatsuba_threshold, int, 0644);
+MODULE_PARM_DESC(karatsuba_threshold,
+                 "operand limbs at which bn_mult switches to Karatsuba");
+module_param_named(toom3_threshold, bn_toom3_threshold, int, 0644);
+MODULE_PARM_DESC(toom3_threshold,
+                 "operand limbs at which bn_mult switches to Toom-3");
+module_param_named(ntt_threshold, bn_ntt_threshold, int, 0644);
+MODULE_PARM_DESC(ntt_threshold,
+                 "operand limbs at which bn_mult switches to the NTT");
+module_param_named(max_parallel, bn_par_max, int, 0644);
+MODULE_PARM_DESC(max_parallel,
+                 "CPUs the multiplies may use at once, for all opens together");
+module_param_named(par_threshold, bn_par_threshold, int, 0644);
+MODULE_PARM_DESC(par_threshold,
+                 "operand limbs at which the multiplies spread over CPUs");
+module_param_named(nr_alloc, bn_nr_alloc, ulong, 0444);
+MODULE_PARM_DESC(nr_alloc, "heap allocations done by the bn library");
+module_param_named(nr_realloc, bn_nr_realloc, ulong, 0444);
+MODULE_PARM_DESC(nr_realloc, "heap reallocations done by the bn library");
+module_param_named(cpu_features, bn_cpu_features, uint, 0444);
+MODULE_PARM_DESC(cpu_features,
+                 "CPU features the bn kernels may use, then those they use "
+                 "(1 ADX, 2 AVX2, 4 AVX-512)");
+
 /*
  * prevent compilor for optimize the none return value
  * from fib_write.
@@ -28,104 +60,886 @@ __attribute__((always_inline)) static inline void escape(void *p)
     __asm__ volatile("" : : "g"(p) : "memory");
 }
 
-/* MAX_LENGTH is set to 92 because
- * ssize_t can't fit the number > 92
- */
-#define MAX_LENGTH 100000
+/* largest n the device serves, the memory of a read grows with F(n) */
+static unsigned long long fib_max_length = 100000;
+module_param_named(max_length, fib_max_length, ullong, 0644);
+MODULE_PARM_DESC(max_length, "largest n served by the device");
+
+/* max_length as an offset, file positions are signed */
+static u64 fib_max_n(void)
+{
+    return min_t(u64, READ_ONCE(fib_max_length), LLONG_MAX);
+}
 
 static dev_t fib_dev = 0;
 static struct cdev *fib_cdev;
 static struct class *fib_class;
-static DEFINE_MUTEX(fib_mutex);
-
-#define FIB_TIME_PROXY(fib_f, result, k)     \
-    ({                                       \
-        ktime_t kt = ktime_get();            \
-        result = fib_f(k);                   \
-        (size_t) ktime_sub(ktime_get(), kt); \
-    })
-#define BN_FIB_TIME_PROXY(fib_f, bn_fib, k)  \
-    ({                                       \
-        ktime_t kt = ktime_get();            \
-        fib_f(bn_fib, k);                    \
-        (size_t) ktime_sub(ktime_get(), kt); \
-    })
 
+/* FIB_ALGO of read() on new opens, FIB_IOC_SET_MODE changes it per open */
+static unsigned int fib_read_mode = FIB_ALGO_FDOUBLING;
+module_param_named(read_mode, fib_read_mode, uint, 0644);
+MODULE_PARM_DESC(read_mode, "FIB_ALGO id of read() on newly opened files");
+
+/*
+ * a result in one of the FIB_FMT formats, held by a cache entry or
+ * kmalloc'ed, strings are NUL-terminated past len
+ */
+struct fib_result {
+    struct fib_cache_entry *e;
+    char *p;
+    size_t len; /* bytes of the result */
+};
+
+/*
+ * state of one open of the device, opens share nothing and compute
+ * concurrently, lock only serializes threads using the same open file
+ */
+struct fib_file {
+    struct mutex lock;
+    bn_arena *arena;       /* scratch for the bn temporaries */
+    bn *stream[2];         /* F(k), F(k+1) of the last sequential read */
+    u64 stream_k;          /* k of stream */
+    void *map;             /* result region for mmap(), FIB_IOC_MAP */
+    size_t map_size;       /* bytes of map */
+
+    /* read() cursor, read_lock serializes read() and lseek() */
+    struct mutex read_lock;
+    unsigned int mode;     /* FIB_ALGO of read */
+    unsigned int format;   /* FIB_FMT of read */
+    struct fib_result cur; /* value being read, cur_n < 0 if none */
+    loff_t cur_n;
+    size_t cur_off; /* bytes of cur already read */
+};
+
+/* sequential reads walk forward jumps up to this long by additions */
+#define FIB_STREAM_MAX_STEPS 128
+
+/* whether mode computes a bn, which can be cached and printed as limbs */
+static bool fib_mode_bn(size_t mode)
+{
+    return mode < FIB_ALGO_NR &&
+           (bn_fib_algos[mode].fib || mode == FIB_ALGO_CKPT);
+}
+
+/* whether read() and the ioctls take mode */
+static bool fib_mode_readable(size_t mode)
+{
+    return fib_mode_bn(mode) || mode == FIB_ALGO_DEC ||
+           mode == FIB_ALGO_STREAM;
+}
+
+/* F(n) by one of the modes for which fib_mode_bn() holds */
+static int fib_compute(bn *fib, size_t mode, u64 n)
+{
+    if (mode == FIB_ALGO_CKPT)
+        fib_ckpt_fib(fib, n);
+    else
+        bn_fib_algos[mode].fib(fib, n);
+    /* the additions stop early for a killed caller, fib is not F(n) */
+    return fatal_signal_pending(current) ? -EINTR : 0;
+}
+
+/* time in ns to compute F(*offset) by the FIB_ALGO id given as size */
 static ssize_t fib_write(struct file *file,
                          const char *buf,
                          size_t mode,
                          loff_t *offset)
 {
+    struct fib_file *ff = file->private_data;
+    bn_arena *arena = ff->arena;
     ktime_t kt;
-    bn *tmp = bn_alloc(1);
-    uint64_t result = 0;
-    switch (mode) {
-    case 0:
-        kt = BN_FIB_TIME_PROXY(bn_fdoubling_v1, tmp, *offset);
-        break;
-    case 1:
-        kt = BN_FIB_TIME_PROXY(bn_fdoubling_v0, tmp, *offset);
-        break;
-    case 2:
-        kt = BN_FIB_TIME_PROXY(bn_fib_v1, tmp, *offset);
-        break;
-    case 10:
-        kt = FIB_TIME_PROXY(fib_sequence, result, *offset);
-        break;
-    case 11:
-        kt = FIB_TIME_PROXY(fib_fast_doubling, result, *offset);
-        break;
-    case 12:
-        kt = BN_FIB_TIME_PROXY(bn_fib_v0, tmp, *offset);
-        break;
+
+    if (mode >= FIB_ALGO_NR || mode == FIB_ALGO_STREAM ||
+        !bn_fib_algos[mode].name)
+        return -EINVAL;
+    /* pwrite() does not go through fib_device_lseek's clamp */
+    if (*offset < 0 || *offset > fib_max_n())
+        return -EINVAL;
+    /* only the decimal algorithm works on a bn_dec */
+    bn_dec *dec = NULL;
+    if (mode == FIB_ALGO_DEC && !(dec = bn_dec_alloc(1)))
+        return -ENOMEM;
+    mutex_lock(&ff->lock);
+    if (bn_arena_reserve(arena, bn_fib_limbs(*offset)) < 0) {
+        mutex_unlock(&ff->lock);
+        bn_dec_free(dec);
+        return -ENOMEM;
     }
+    bn *tmp = bn_alloc_arena(arena, 1);
+    uint64_t result = 0;
+    int rc = 0;
+    kt = ktime_get();
+    if (mode == FIB_ALGO_DEC)
+        rc = bn_dec_fdoubling(dec, *offset) ? -ENOMEM : 0;
+    else if (mode == FIB_ALGO_U64_ADD)
+        result = fib_sequence(*offset);
+    else if (mode == FIB_ALGO_U64_FDOUBLING)
+        result = fib_fast_doubling(*offset);
+    else
+        rc = fib_compute(tmp, mode, *offset);
+    kt = ktime_sub(ktime_get(), kt);
+    if (!rc && fatal_signal_pending(current))
+        rc = -EINTR;
     escape(tmp);
+    escape(dec);
     escape(&result);
-    bn_free(tmp);
-    return (ssize_t) ktime_to_ns(kt);
+    bn_arena_reset(arena);
+    mutex_unlock(&ff->lock);
+    bn_dec_free(dec);
+    return rc ? rc : (ssize_t) ktime_to_ns(kt);
+}
+
+/* F(k) computed on decimal limbs, printed without radix conversion */
+static char *fib_dec_string(u64 k)
+{
+    bn_dec *fib = bn_dec_alloc(1);
+    char *p = NULL;
+    if (fib && !bn_dec_fdoubling(fib, k))
+        p = bn_dec_to_string(fib);
+    bn_dec_free(fib);
+    return p;
+}
+
+/*
+ * F(n) into ff->stream[0] for sequential scans: the open file keeps
+ * F(k), F(k+1) of the last read, so reading k + 1 next costs a single
+ * bn_add
+ * ff->lock must be held, return 0 on success, -ENOMEM on error
+ */
+static int fib_stream_seek(struct fib_file *ff, u64 n)
+{
+    if (!ff->stream[0]) {
+        bn *f0 = bn_alloc(1), *f1 = bn_alloc(1);
+        if (!f0 || !f1) {
+            bn_free(f0);
+            bn_free(f1);
+            return -ENOMEM;
+        }
+        f1->number[0] = 1;
+        ff->stream[0] = f0;
+        ff->stream[1] = f1;
+        ff->stream_k = 0;
+    }
+
+    if (n < ff->stream_k || n - ff->stream_k > FIB_STREAM_MAX_STEPS) {
+        bn_fdoubling_pair(ff->stream[0], ff->stream[1], n);
+        ff->stream_k = n;
+    }
+    for (; ff->stream_k < n; ff->stream_k++) {
+        bn_add(ff->stream[0], ff->stream[1], ff->stream[0]);
+        bn_swap(ff->stream[0], ff->stream[1]);
+    }
+    return 0;
+}
+
+/* F(n) as a decimal string for sequential scans */
+static char *fib_stream_read(struct fib_file *ff, u64 n)
+{
+    char *p = NULL;
+
+    mutex_lock(&ff->lock);
+    if (!fib_stream_seek(ff, n))
+        p = bn_to_string(ff->stream[0]);
+    mutex_unlock(&ff->lock);
+    return p;
 }
 
-/* calculate the fibonacci number at given offset */
+static const char *fib_result_str(const struct fib_result *r)
+{
+    return r->e ? r->e->str : r->p;
+}
+
+static void fib_result_put(struct fib_result *r)
+{
+    if (r->e)
+        fib_cache_put(r->e);
+    kvfree(r->p);
+}
+
+/*
+ * F(n) as a decimal string, computed by the given FIB_ALGO
+ * return 0 on success, -errno on error
+ */
+static int fib_result_dec(struct fib_file *ff,
+                          size_t mode,
+                          u64 n,
+                          struct fib_result *r)
+{
+    if (mode == FIB_ALGO_STREAM) {
+        r->p = fib_stream_read(ff, n);
+        return r->p ? 0 : -ENOMEM;
+    }
+    r->e = fib_cache_get(n);
+    if (r->e)
+        return 0;
+
+    bn_arena *arena = ff->arena;
+    mutex_lock(&ff->lock);
+    if (bn_arena_reserve(arena, bn_fib_limbs(n)) < 0) {
+        mutex_unlock(&ff->lock);
+        return -ENOMEM;
+    }
+    bn *fib = bn_alloc_arena(arena, 1);
+    int rc = -ENOMEM;
+
+    if (mode == FIB_ALGO_DEC) {
+        r->p = fib_dec_string(n);
+    } else {
+        rc = fib_compute(fib, mode, n);
+        if (!rc)
+            r->p = bn_to_string(fib);
+    }
+    /* only the binary algorithms leave a bn behind to cache */
+    if (r->p && fib_mode_bn(mode)) {
+        r->e = fib_cache_insert(n, fib, r->p);
+        if (r->e)
+            r->p = NULL;
+    }
+    bn_arena_reset(arena);
+    mutex_unlock(&ff->lock);
+    if (r->e || r->p)
+        return 0;
+    return rc ? rc : -ENOMEM;
+}
+
+/* fib as FIB_FMT_HEX or FIB_FMT_BIN into r->p */
+static int fib_result_fmt(const bn *fib, unsigned int format,
+                          struct fib_result *r)
+{
+    if (format == FIB_FMT_HEX) {
+        r->p = bn_to_hex(fib);
+        if (!r->p)
+            return -ENOMEM;
+        r->len = strlen(r->p);
+        return 0;
+    }
+
+    struct fib_bin_hdr hdr = {
+        .size = fib->size,
+        .limb_size = sizeof(bn_data),
+        .sign = fib->sign,
+    };
+    while (hdr.size > 1 && !fib->number[hdr.size - 1])
+        hdr.size--;
+    r->len = sizeof(hdr) + sizeof(bn_data) * hdr.size;
+    r->p = kvmalloc(r->len, GFP_KERNEL);
+    if (!r->p)
+        return -ENOMEM;
+    memcpy(r->p, &hdr, sizeof(hdr));
+    memcpy(r->p + sizeof(hdr), fib->number, sizeof(bn_data) * hdr.size);
+    return 0;
+}
+
+/*
+ * F(n) as hex or limbs, computed by the given FIB_ALGO
+ * these skip the decimal conversion, so they reuse the bn of a cached
+ * result but add nothing to the cache
+ */
+static int fib_result_raw(struct fib_file *ff,
+                          size_t mode,
+                          unsigned int format,
+                          u64 n,
+                          struct fib_result *r)
+{
+    int rc;
+
+    /* decimal limbs have no binary value to print */
+    if (mode == FIB_ALGO_DEC)
+        return -EINVAL;
+    if (mode != FIB_ALGO_STREAM) {
+        struct fib_cache_entry *e = fib_cache_get(n);
+        if (e) {
+            rc = fib_result_fmt(e->fib, format, r);
+            fib_cache_put(e);
+            return rc;
+        }
+    }
+
+    mutex_lock(&ff->lock);
+    if (mode == FIB_ALGO_STREAM) {
+        rc = fib_stream_seek(ff, n);
+        if (!rc)
+            rc = fib_result_fmt(ff->stream[0], format, r);
+    } else if (bn_arena_reserve(ff->arena, bn_fib_limbs(n)) < 0) {
+        rc = -ENOMEM;
+    } else {
+        bn *fib = bn_alloc_arena(ff->arena, 1);
+        rc = fib_compute(fib, mode, n);
+        if (!rc)
+            rc = fib_result_fmt(fib, format, r);
+        bn_arena_reset(ff->arena);
+    }
+    mutex_unlock(&ff->lock);
+    return rc;
+}
+
+/*
+ * F(n) in the given format, computed by the given FIB_ALGO
+ * return 0 on success, -errno on error
+ */
+static int fib_result_get(struct fib_file *ff,
+                          size_t mode,
+                          unsigned int format,
+                          u64 n,
+                          struct fib_result *r)
+{
+    int rc;
+
+    r->e = NULL;
+    r->p = NULL;
+    if (format != FIB_FMT_DEC)
+        return fib_result_raw(ff, mode, format, n, r);
+    rc = fib_result_dec(ff, mode, n, r);
+    if (!rc)
+        r->len = strlen(fib_result_str(r));
+    return rc;
+}
+
+/*
+ * calculate the fibonacci number at given offset
+ * the value reads as its digits and a newline, or as a fib_bin_hdr and
+ * the limbs, in as many read() calls as the buffer size takes, and a
+ * read never spans two values: the next read returns 0, or
+ * F(offset + 1) in FIB_ALGO_STREAM, which moves the position on once a
+ * value has been read in full
+ */
 static ssize_t fib_read(struct file *file,
-                        char *buf,
-                        size_t mode,
+                        char __user *buf,
+                        size_t count,
                         loff_t *offset)
 {
-    bn *fib = bn_alloc(1);
+    struct fib_file *ff = file->private_data;
+    ssize_t rc = 0;
 
-    switch (mode) {
-    case 0:
-        bn_fib_v1(fib, *offset);
-        break;
-    case 1:
-        bn_fdoubling_v0(fib, *offset);
-        break;
-    case 2:
-        bn_fdoubling_v1(fib, *offset);
-        break;
+    /* pread() does not go through fib_device_lseek's clamp */
+    if (*offset < 0 || *offset > fib_max_n())
+        return -EINVAL;
+    mutex_lock(&ff->read_lock);
+    if (ff->cur_n != *offset) {
+        if (ff->cur_n >= 0)
+            fib_result_put(&ff->cur);
+        ff->cur_n = -1;
+        rc = fib_result_get(ff, ff->mode, ff->format, *offset, &ff->cur);
+        if (rc < 0)
+            goto out;
+        ff->cur_n = *offset;
+        ff->cur_off = 0;
+    }
+
+    const char *s = fib_result_str(&ff->cur);
+    size_t len = ff->cur.len;
+    size_t eol = ff->format != FIB_FMT_BIN; /* strings end in a newline */
+    size_t part = 0;
+    /* the result first, then the newline that the string lacks */
+    if (ff->cur_off < len) {
+        part = min(count, len - ff->cur_off);
+        if (copy_to_user(buf, s + ff->cur_off, part)) {
+            rc = -EFAULT;
+            goto out;
+        }
     }
-    // bn_fib(fib, *offset);
-    char *p = bn_to_string(fib);
-    size_t len = strlen(p) + 1;
-    size_t left = copy_to_user(buf, p, len);
-    // printk(KERN_DEBUG "fib(%d): %s\n", (int) *offset, p);
-    bn_free(fib);
-    kfree(p);
-    return left;  // return number of bytes that could not be copied
+    rc = part;
+    if (eol && ff->cur_off + part == len && count > part) {
+        if (!put_user('\n', buf + part))
+            rc++;
+        else if (!part)
+            rc = -EFAULT;
+    }
+    if (rc < 0)
+        goto out;
+    ff->cur_off += rc;
+    // printk(KERN_DEBUG "fib(%d): %s\n", (int) *offset, s);
+    if (ff->mode == FIB_ALGO_STREAM && ff->cur_off == len + eol &&
+        *offset < fib_max_n())
+        (*offset)++;
+out:
+    mutex_unlock(&ff->read_lock);
+    return rc;  // return number of bytes read
+}
+
+/* compute one value of a batch into the user buffer at b->used */
+static int fib_batch_one(struct fib_file *ff,
+                         const struct fib_batch *b,
+                         struct fib_req *req)
+{
+    struct fib_result r;
+    int rc;
+
+    if (req->n > fib_max_n() || !fib_mode_readable(req->mode) ||
+        req->format > FIB_FMT_HEX)
+        return -EINVAL;
+    rc = fib_result_get(ff, req->mode, req->format, req->n, &r);
+    if (rc < 0)
+        return rc;
+
+    const char *s = fib_result_str(&r);
+    req->offset = b->used;
+    /* strings are packed with their NUL */
+    req->len = r.len + (req->format != FIB_FMT_BIN);
+    if (req->len > b->size - b->used)
+        rc = -ENOSPC;
+    else if (copy_to_user(u64_to_user_ptr(b->buf + b->used), s, req->len))
+        rc = -EFAULT;
+    fib_result_put(&r);
+    return rc;
+}
+
+/*
+ * FIB_IOC_BATCH: many values in one trip, with the per-value status
+ * reported in the requests themselves
+ */
+static long fib_ioctl_batch(struct fib_file *ff, void __user *arg)
+{
+    struct fib_req __user *ureqs;
+    struct fib_batch b;
+
+    if (copy_from_user(&b, arg, sizeof(b)))
+        return -EFAULT;
+    if (b.nr > FIB_BATCH_MAX)
+        return -EINVAL;
+    ureqs = u64_to_user_ptr(b.reqs);
+    b.used = 0;
+
+    for (__u32 i = 0; i < b.nr; i++) {
+        struct fib_req req;
+        /* up to FIB_BATCH_MAX values, let a killed caller go */
+        if (fatal_signal_pending(current))
+            return -EINTR;
+        cond_resched();
+        if (copy_from_user(&req, &ureqs[i], sizeof(req)))
+            return -EFAULT;
+        req.offset = req.len = 0;
+        req.status = fib_batch_one(ff, &b, &req);
+        if (req.status == -EFAULT)
+            return -EFAULT;
+        if (!req.status)
+            b.used += req.len;
+        if (copy_to_user(&ureqs[i], &req, sizeof(req)))
+            return -EFAULT;
+    }
+
+    if (copy_to_user(arg, &b, sizeof(b)))
+        return -EFAULT;
+    return 0;
+}
+
+/* bytes of results one FIB_IOC_RANGE window stages in the kernel */
+#define FIB_RANGE_WINDOW (16 << 20)
+
+/*
+ * bytes F(n) takes in format at most, strings with their NUL
+ * the digits are counted by parts so that n x 1736 can't overflow
+ */
+static size_t fib_fmt_max(u64 n, unsigned int format)
+{
+    switch (format) {
+    case FIB_FMT_BIN:
+        return sizeof(struct fib_bin_hdr) + sizeof(bn_data) * bn_fib_limbs(n);
+    case FIB_FMT_HEX:
+        /* F(n) < phi^n, log16(phi) < 0.1736 */
+        return n / 10000 * 1736 + n % 10000 * 1736 / 10000 + 2;
+    default:
+        /* log10(phi) < 0.209 */
+        return n / 1000 * 209 + n % 1000 * 209 / 1000 + 2;
+    }
+}
+
+/* consecutive values of a range, computed on one CPU */
+struct fib_range_chunk {
+    u64 s, e; /* F(s) to F(e) */
+    u64 next; /* first n not in buf */
+    unsigned int format;
+    char *buf;
+    size_t size; /* bytes of buf, enough for F(s) to F(e) */
+    size_t used;
+    int rc;
+};
+
+/* append fib in the format of c to c->buf */
+static int fib_range_put(struct fib_range_chunk *c, const bn *fib)
+{
+    struct fib_result r = {0};
+    int rc;
+
+    if (c->format == FIB_FMT_DEC) {
+        r.p = bn_to_string(fib);
+        if (!r.p)
+            return -ENOMEM;
+        r.len = strlen(r.p);
+    } else {
+        rc = fib_result_fmt(fib, c->format, &r);
+        if (rc < 0)
+            return rc;
+    }
+
+    size_t len = r.len + (c->format != FIB_FMT_BIN);
+    rc = -ENOSPC;
+    if (len <= c->size - c->used) {
+        memcpy(c->buf + c->used, r.p, len);
+        c->used += len;
+        rc = 0;
+    }
+    kvfree(r.p);
+    return rc;
+}
+
+/* fib_par_run callback: F(s) by fast doubling, the rest by additions */
+static void fib_range_chunk_run(void *arg, int i)
+{
+    struct fib_range_chunk *c = (struct fib_range_chunk *) arg + i;
+    bn *f0 = bn_alloc(1), *f1 = bn_alloc(1);
+
+    c->next = c->s;
+    c->buf = kvmalloc(c->size, GFP_KERNEL);
+    if (!f0 || !f1 || !c->buf) {
+        c->rc = -ENOMEM;
+        goto out;
+    }
+    bn_fdoubling_pair(f0, f1, c->s);
+    for (; c->next <= c->e; c->next++) {
+        c->rc = fib_range_put(c, f0);
+        if (c->rc < 0)
+            break;
+        bn_add(f0, f1, f0);
+        bn_swap(f0, f1);
+    }
+out:
+    bn_free(f0);
+    bn_free(f1);
+}
+
+/*
+ * the values from r->next on that surely fit in the rest of the buffer
+ * and a window, split into a chunk per CPU of about the same bytes,
+ * computed and copied out in order
+ * return 0 on success, -errno on error
+ */
+static int fib_range_window(struct fib_range *r)
+{
+    size_t room = min_t(u64, r->size - r->used, FIB_RANGE_WINDOW);
+    size_t total = 0;
+    u64 e = r->next; /* one past the last value */
+    while (e <= r->b && total + fib_fmt_max(e, r->format) <= room)
+        total += fib_fmt_max(e++, r->format);
+    if (e == r->next)
+        return -ENOSPC;
+
+    int nr = min_t(u64, max(READ_ONCE(bn_par_max), 1), e - r->next);
+    struct fib_range_chunk *c = kvcalloc(nr, sizeof(*c), GFP_KERNEL);
+    if (!c)
+        return -ENOMEM;
+    u64 k = r->next;
+    size_t sum = 0;
+    for (int i = 0; i < nr; i++) {
+        c[i].s = k;
+        c[i].format = r->format;
+        /* at least one value, and one left for each chunk after */
+        do {
+            size_t len = fib_fmt_max(k++, r->format);
+            c[i].size += len;
+            sum += len;
+        } while (k < e - (nr - 1 - i) &&
+                 (i == nr - 1 || sum < total / nr * (i + 1)));
+        c[i].e = k - 1;
+    }
+
+    fib_par_run(fib_range_chunk_run, c, nr);
+
+    /* a chunk that failed ends the window after what it did compute */
+    int rc = 0;
+    for (int i = 0; i < nr; i++) {
+        if (!rc && copy_to_user(u64_to_user_ptr(r->buf + r->used), c[i].buf,
+                                c[i].used))
+            rc = -EFAULT;
+        if (!rc) {
+            r->used += c[i].used;
+            r->next = c[i].next;
+            rc = c[i].rc;
+        }
+        kvfree(c[i].buf);
+    }
+    kvfree(c);
+    return rc;
+}
+
+/* FIB_IOC_RANGE: F(a) to F(b) in order, see struct fib_range */
+static long fib_ioctl_range(void __user *arg)
+{
+    struct fib_range r;
+    int rc = 0;
+
+    if (copy_from_user(&r, arg, sizeof(r)))
+        return -EFAULT;
+    if (r.a > r.b || r.b > fib_max_n() || r.format > FIB_FMT_HEX)
+        return -EINVAL;
+    r.used = 0;
+    r.next = r.a;
+
+    while (!rc && r.next <= r.b) {
+        rc = fib_range_window(&r);
+        if (!rc && fatal_signal_pending(current))
+            rc = -EINTR;
+    }
+    if (rc == -EFAULT)
+        return rc;
+    /* values in the buffer make it a success, next tells how far */
+    if (r.next > r.a)
+        rc = 0;
+    if (copy_to_user(arg, &r, sizeof(r)))
+        return -EFAULT;
+    return rc;
+}
+
+/* bytes of an mmap() region enough for F(max_length) in any format */
+static size_t fib_map_size(void)
+{
+    /* F(n) has fewer than n / 4 decimal digits and n * 0.7 bits */
+    return PAGE_ALIGN(FIB_MAP_DATA + fib_max_n() / 4 + 16);
+}
+
+/*
+ * allocate the mmap() region of ff on first use, with ff->lock held
+ * the first mmap() picks its size, so a small mapping costs little
+ * whatever max_length is
+ */
+static int fib_map_alloc(struct fib_file *ff, size_t size)
+{
+    if (!ff->map) {
+        ff->map = vmalloc_user(size);
+        ff->map_size = ff->map ? size : 0;
+    }
+    return ff->map ? 0 : -ENOMEM;
+}
+
+/* bytes of the region of ff, or of a new one */
+static size_t fib_map_avail(struct fib_file *ff)
+{
+    size_t size;
+    mutex_lock(&ff->lock);
+    size = ff->map ? ff->map_size : fib_map_size();
+    mutex_unlock(&ff->lock);
+    return size;
+}
+
+/* the result region is read only for userspace */
+static int fib_mmap(struct file *file, struct vm_area_struct *vma)
+{
+    struct fib_file *ff = file->private_data;
+    int rc;
+
+    size_t size = vma->vm_end - vma->vm_start;
+    if (vma->vm_pgoff || size > fib_map_size())
+        return -EINVAL;
+    if (vma->vm_flags & VM_WRITE)
+        return -EPERM;
+    /* nor let mprotect() make it writable later */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+    mutex_lock(&ff->lock);
+    rc = fib_map_alloc(ff, size);
+    if (!rc && size > ff->map_size)
+        rc = -EINVAL;
+    if (!rc)
+        rc = remap_vmalloc_range(vma, ff->map, 0);
+    mutex_unlock(&ff->lock);
+    return rc;
+}
+
+/* limbs of F(n) into the region, with ff->lock held */
+static int fib_map_bin(struct fib_file *ff, const struct fib_map_req *req)
+{
+    struct fib_map_hdr *hdr = ff->map;
+
+    if (bn_arena_reserve(ff->arena, bn_fib_limbs(req->n)) < 0)
+        return -ENOMEM;
+    bn *fib = bn_alloc_arena(ff->arena, 1);
+    int rc = fib_compute(fib, req->mode, req->n);
+    size_t len = sizeof(bn_data) * fib->size;
+    if (!rc && len > ff->map_size - FIB_MAP_DATA)
+        rc = -ENOSPC;
+    if (!rc) {
+        hdr->len = len;
+        memcpy((char *) ff->map + FIB_MAP_DATA, fib->number, len);
+    }
+    bn_arena_reset(ff->arena);
+    return rc;
+}
+
+/* decimal or hex string of F(n) into the region */
+static int fib_map_str(struct fib_file *ff, const struct fib_map_req *req)
+{
+    struct fib_map_hdr *hdr = ff->map;
+    struct fib_result r;
+    int rc = fib_result_get(ff, req->mode, req->format, req->n, &r);
+    if (rc < 0)
+        return rc;
+
+    const char *s = fib_result_str(&r);
+    mutex_lock(&ff->lock);
+    if (r.len + 1 <= ff->map_size - FIB_MAP_DATA) {
+        hdr->len = r.len + 1;
+        memcpy((char *) ff->map + FIB_MAP_DATA, s, hdr->len);
+    } else {
+        rc = -ENOSPC;
+    }
+    mutex_unlock(&ff->lock);
+    fib_result_put(&r);
+    return rc;
+}
+
+/*
+ * FIB_IOC_MAP: compute F(n) into the mmap() region, the header tells
+ * the length, userspace reads the value in place
+ */
+static long fib_ioctl_map(struct fib_file *ff, void __user *arg)
+{
+    struct fib_map_req req;
+    struct fib_map_hdr *hdr;
+    int rc;
+
+    if (copy_from_user(&req, arg, sizeof(req)))
+        return -EFAULT;
+    if (req.n > fib_max_n() || !fib_mode_readable(req.mode) ||
+        req.format > FIB_FMT_HEX)
+        return -EINVAL;
+    /* decimal limbs have no binary value and the stream only makes strings */
+    if (req.format == FIB_FMT_BIN && !fib_mode_bn(req.mode))
+        return -EINVAL;
+
+    mutex_lock(&ff->lock);
+    rc = fib_map_alloc(ff, fib_map_size());
+    if (!rc && req.format == FIB_FMT_BIN)
+        rc = fib_map_bin(ff, &req);
+    mutex_unlock(&ff->lock);
+    if (!rc && req.format != FIB_FMT_BIN)
+        rc = fib_map_str(ff, &req);
+
+    hdr = ff->map;
+    if (hdr) {
+        mutex_lock(&ff->lock);
+        hdr->n = req.n;
+        hdr->format = req.format;
+        hdr->limb_size = sizeof(bn_data);
+        hdr->status = rc;
+        if (rc)
+            hdr->len = 0;
+        mutex_unlock(&ff->lock);
+    }
+    return rc;
+}
+
+/* FIB_IOC_MOD: F(n) mod m, which builds no bn, so max_length does not apply */
+static long fib_ioctl_mod(void __user *arg)
+{
+    struct fib_mod req;
+
+    if (copy_from_user(&req, arg, sizeof(req)))
+        return -EFAULT;
+    if (!req.m)
+        return -EINVAL;
+    req.result = fib_fast_doubling_mod(req.n, req.m);
+    if (copy_to_user(arg, &req, sizeof(req)))
+        return -EFAULT;
+    return 0;
+}
+
+/* FIB_IOC_SET_MODE: the FIB_ALGO of read() on this open file */
+static long fib_ioctl_set_mode(struct fib_file *ff, void __user *arg)
+{
+    __u32 mode;
+
+    if (copy_from_user(&mode, arg, sizeof(mode)))
+        return -EFAULT;
+    if (!fib_mode_readable(mode))
+        return -EINVAL;
+    mutex_lock(&ff->read_lock);
+    ff->mode = mode;
+    ff->cur_off = 0; /* the current value is read again */
+    if (ff->cur_n >= 0)
+        fib_result_put(&ff->cur);
+    ff->cur_n = -1;
+    mutex_unlock(&ff->read_lock);
+    return 0;
+}
+
+/* FIB_IOC_SET_FORMAT: the output format of read() on this open file */
+static long fib_ioctl_set_format(struct fib_file *ff, void __user *arg)
+{
+    __u32 format;
+
+    if (copy_from_user(&format, arg, sizeof(format)))
+        return -EFAULT;
+    if (format > FIB_FMT_HEX)
+        return -EINVAL;
+    mutex_lock(&ff->read_lock);
+    ff->format = format;
+    ff->cur_off = 0;
+    if (ff->cur_n >= 0)
+        fib_result_put(&ff->cur);
+    ff->cur_n = -1;
+    mutex_unlock(&ff->read_lock);
+    return 0;
+}
+
+static long fib_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+    switch (cmd) {
+    case FIB_IOC_BATCH:
+        return fib_ioctl_batch(file->private_data, (void __user *) arg);
+    case FIB_IOC_MAP:
+        return fib_ioctl_map(file->private_data, (void __user *) arg);
+    case FIB_IOC_SET_MODE:
+        return fib_ioctl_set_mode(file->private_data, (void __user *) arg);
+    case FIB_IOC_SET_FORMAT:
+        return fib_ioctl_set_format(file->private_data, (void __user *) arg);
+    case FIB_IOC_RANGE:
+        return fib_ioctl_range((void __user *) arg);
+    case FIB_IOC_MOD:
+        return fib_ioctl_mod((void __user *) arg);
+    case FIB_IOC_MAP_SIZE: {
+        __u64 size = fib_map_avail(file->private_data);
+        if (copy_to_user((void __user *) arg, &size, sizeof(size)))
+            return -EFAULT;
+        return 0;
+    }
+    }
+    return -ENOTTY;
 }
 
 static int fib_open(struct inode *inode, struct file *file)
 {
-    if (!mutex_trylock(&fib_mutex)) {
-        printk(KERN_ALERT "fibdrv is in use");
-        return -EBUSY;
+    struct fib_file *ff = kzalloc(sizeof(*ff), GFP_KERNEL);
+    if (!ff)
+        return -ENOMEM;
+    ff->arena = bn_arena_new();
+    if (!ff->arena) {
+        kfree(ff);
+        return -ENOMEM;
     }
+    mutex_init(&ff->lock);
+    mutex_init(&ff->read_lock);
+    ff->mode = fib_mode_readable(fib_read_mode) ? fib_read_mode
+                                                : FIB_ALGO_FDOUBLING;
+    ff->cur_n = -1;
+    file->private_data = ff;
     return 0;
 }
 
 static int fib_release(struct inode *inode, struct file *file)
 {
-    mutex_unlock(&fib_mutex);
+    struct fib_file *ff = file->private_data;
+    if (ff->cur_n >= 0)
+        fib_result_put(&ff->cur);
+    mutex_destroy(&ff->read_lock);
+    mutex_destroy(&ff->lock);
+    bn_free(ff->stream[0]);
+    bn_free(ff->stream[1]);
+    vfree(ff->map);
+    bn_arena_free(ff->arena);
+    kfree(ff);
     return 0;
 }
 
@@ -141,15 +955,27 @@ static loff_t fib_device_lseek(struct file *file, loff_t offset, int orig)
         new_pos = file->f_pos + offset;
         break;
     case 2: /* SEEK_END: */
-        new_pos = MAX_LENGTH - offset;
+        new_pos = fib_max_n() - offset;
         break;
     }
 
-    if (new_pos > MAX_LENGTH)
-        new_pos = MAX_LENGTH;  // max case
+    if (new_pos > fib_max_n())
+        new_pos = fib_max_n();  // max case
     if (new_pos < 0)
-        new_pos = 0;        // min case
+        new_pos = 0;  // min case
+
+    /*
+     * seeking computes the value again, even at the same offset, so a
+     * timed lseek/read pair never hits the value of the previous read
+     */
+    struct fib_file *ff = file->private_data;
+    mutex_lock(&ff->read_lock);
+    ff->cur_off = 0;
+    if (ff->cur_n >= 0)
+        fib_result_put(&ff->cur);
+    ff->cur_n = -1;
     file->f_pos = new_pos;  // This is what we'll use now
+    mutex_unlock(&ff->read_lock);
     return new_pos;
 }
 
@@ -160,13 +986,21 @@ const struct file_operations fib_fops = {
     .open = fib_open,
     .release = fib_release,
     .llseek = fib_device_lseek,
+    .unlocked_ioctl = fib_ioctl,
+    .mmap = fib_mmap,
 };
 
 static int __init init_fib_dev(void)
 {
     int rc = 0;
 
-    mutex_init(&fib_mutex);
+    bn_init();
+    fib_cache_init();
+    rc = fib_par_init();
+    if (rc < 0) {
+        fib_cache_exit();
+        return rc;
+    }
 
     // Let's register the device
     // This will dynamically allocate the major number
@@ -176,6 +1010,8 @@ static int __init init_fib_dev(void)
         printk(KERN_ALERT
                "Failed to register the fibonacci char device. rc = %i",
                rc);
+        fib_par_exit();
+        fib_cache_exit();
         return rc;
     }
 
@@ -214,16 +1050,20 @@ failed_class_create:
     cdev_del(fib_cdev);
 failed_cdev:
     unregister_chrdev_region(fib_dev, 1);
+    fib_par_exit();
+    fib_cache_exit();
     return rc;
 }
 
 static void __exit exit_fib_dev(void)
 {
-    mutex_destroy(&fib_mutex);
     device_destroy(fib_class, fib_dev);
     class_destroy(fib_class);
     cdev_del(fib_cdev);
     unregister_chrdev_region(fib_dev, 1);
+    fib_par_exit();
+    fib_cache_exit();
+    fib_ckpt_exit();
 }
 
 module_init(init_fib_dev);
@@ -0,0 +1,135 @@
+#ifndef FIBDRV_IOCTL_H
+#define FIBDRV_IOCTL_H
+
+/* shared by fibdrv and its clients */
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* output formats of a request */
+#define FIB_FMT_DEC 0 /* NUL-terminated decimal string */
+#define FIB_FMT_BIN 1 /* limbs, least significant first, host byte order */
+#define FIB_FMT_HEX 2 /* NUL-terminated lowercase hexadecimal string */
+
+/*
+ * algorithms, the mode of read(), write(), batches and FIB_IOC_SET_MODE
+ * write() times any of them but FIB_ALGO_STREAM, read() and the ioctls
+ * take all but the u64 ones, which overflow past F(93)
+ */
+#define FIB_ALGO_ADD 0            /* additions of bns */
+#define FIB_ALGO_FDOUBLING_V0 1   /* fast doubling, copying its state */
+#define FIB_ALGO_FDOUBLING 2      /* fast doubling */
+#define FIB_ALGO_DEC 3            /* fast doubling on decimal limbs */
+#define FIB_ALGO_CKPT 4           /* resumed from the nearest checkpoint */
+#define FIB_ALGO_STREAM 5         /* additions from the last value read */
+#define FIB_ALGO_QMATRIX 6        /* powers of the Q-matrix */
+#define FIB_ALGO_LUCAS 7          /* doubling with Lucas numbers */
+#define FIB_ALGO_ADD_V0 8         /* additions of bns, three of them */
+#define FIB_ALGO_FDOUBLING_V2 9   /* fast doubling with two squares */
+#define FIB_ALGO_U64_ADD 10       /* additions of u64 */
+#define FIB_ALGO_U64_FDOUBLING 11 /* fast doubling on u64 */
+#define FIB_ALGO_NR 12
+
+/*
+ * FIB_FMT_BIN as read() and FIB_IOC_BATCH return it: this header, then
+ * size limbs of limb_size bytes
+ */
+struct fib_bin_hdr {
+    __u32 size; /* limbs that follow, at least 1 */
+    __u32 limb_size;
+    __s32 sign; /* 1 if negative */
+    __u32 reserved;
+};
+
+/*
+ * one value of a batch
+ * n, mode and format are filled by the caller, mode being a FIB_ALGO
+ * id, the rest is filled by the driver
+ */
+struct fib_req {
+    __u64 n;
+    __u32 mode;
+    __u32 format;
+    __u64 offset; /* where the result starts in the batch buffer */
+    __u64 len;    /* bytes of the result */
+    __s32 status; /* 0, or -errno if this value has no result */
+    __u32 reserved;
+};
+
+/*
+ * compute nr values in one call, the results are packed one after
+ * another into buf, a value that does not fit gets -ENOSPC
+ */
+struct fib_batch {
+    __u64 reqs; /* struct fib_req[nr] */
+    __u64 buf;
+    __u64 size; /* bytes of buf */
+    __u64 used; /* bytes of buf filled by the driver */
+    __u32 nr;
+    __u32 reserved;
+};
+
+/*
+ * header at the start of the region mmap()ed at offset 0, the result
+ * of the last FIB_IOC_MAP follows at FIB_MAP_DATA
+ */
+struct fib_map_hdr {
+    __u64 n;
+    __u64 len; /* bytes of the result */
+    __u32 format;
+    __u32 limb_size; /* bytes per limb of FIB_FMT_BIN */
+    __s32 status;    /* 0, or -errno if the region holds no result */
+    __u32 reserved;
+};
+
+#define FIB_MAP_DATA 64
+
+/*
+ * F(a) to F(b) in order, packed into buf as a batch packs its results:
+ * strings with their NUL, or fib_bin_hdr and the limbs
+ * the range is split over up to max_parallel CPUs, each seeded by one
+ * fast doubling and going on by additions; the call stops before the
+ * first value that does not fit, next is where to go on from, b + 1
+ * once the range is done
+ */
+struct fib_range {
+    __u64 a;
+    __u64 b;
+    __u64 buf;
+    __u64 size; /* bytes of buf */
+    __u64 used; /* bytes of buf filled by the driver */
+    __u64 next; /* first n not in buf */
+    __u32 format;
+    __u32 reserved;
+};
+
+/* F(n) mod m, m > 0, computed on 64-bit residues for any n */
+struct fib_mod {
+    __u64 n;
+    __u64 m;
+    __u64 result; /* filled by the driver */
+};
+
+/* compute F(n) into the mmap()ed region */
+struct fib_map_req {
+    __u64 n;
+    __u32 mode;
+    __u32 format;
+};
+
+#define FIB_IOC_MAGIC 'f'
+#define FIB_IOC_BATCH _IOWR(FIB_IOC_MAGIC, 1, struct fib_batch)
+#define FIB_IOC_MAP _IOW(FIB_IOC_MAGIC, 2, struct fib_map_req)
+/* bytes of the region that can be mmap()ed */
+#define FIB_IOC_MAP_SIZE _IOR(FIB_IOC_MAGIC, 3, __u64)
+/* __u32 FIB_ALGO id of read() on this open file, read_mode by default */
+#define FIB_IOC_SET_MODE _IOW(FIB_IOC_MAGIC, 4, __u32)
+/* __u32 FIB_FMT of read() on this open file, FIB_FMT_DEC by default */
+#define FIB_IOC_SET_FORMAT _IOW(FIB_IOC_MAGIC, 5, __u32)
+#define FIB_IOC_RANGE _IOWR(FIB_IOC_MAGIC, 6, struct fib_range)
+#define FIB_IOC_MOD _IOWR(FIB_IOC_MAGIC, 7, struct fib_mod)
+
+/* values per FIB_IOC_BATCH call */
+#define FIB_BATCH_MAX 65536
+
+#endif /* FIBDRV_IOCTL_H */
@@ -0,0 +1,26 @@
+#!/usr/bin/env python3
+
+# write fib_table.h, F(n) for every n with F(n) below 2^128
+# usage: scripts/gen-fib-table.py > fib_table.h
+
+fib = [0, 1]
+while fib[-1] + fib[-2] < 1 << 128:
+    fib.append(fib[-1] + fib[-2])
+u64_max = max(n for n, f in enumerate(fib) if f < 1 << 64)
+mask = (1 << 64) - 1
+
+print('/* generated by scripts/gen-fib-table.py, do not edit */')
+print('#ifndef FIB_TABLE_H')
+print('#define FIB_TABLE_H')
+print()
+print('/* largest n with F(n) below 2^128, and below 2^64 */')
+print('#define FIB_TABLE_MAX %d' % (len(fib) - 1))
+print('#define FIB_TABLE_U64_MAX %d' % u64_max)
+print()
+print('/* F(n) as its low and high 64 bits */')
+print('static const uint64_t fib_table[FIB_TABLE_MAX + 1][2] = {')
+for n, f in enumerate(fib):
+    print('    {0x%016x, 0x%016x}, /* %d */' % (f & mask, f >> 64, n))
+print('};')
+print()
+print('#endif /* FIB_TABLE_H */')
@@ -0,0 +1,17 @@
+reset
+set xlabel 'limbs'
+set ylabel 'throughput (GB/s)'
+set title 'bn\_add throughput by limb kernel'
+set term png enhanced font 'Verdana,10'
+set output 'plot_add.png'
+set grid
+set key left top
+set logscale x 2
+set datafile missing '-'
+plot \
+'plot_add' \
+using 1:2 with linespoints linewidth 2 title "adc",\
+'plot_add' \
+using 1:3 with linespoints linewidth 2 title "AVX2",\
+'plot_add' \
+using 1:4 with linespoints linewidth 2 title "AVX-512"
@@ -0,0 +1,16 @@
+reset
+set xlabel 'F(n)'
+set ylabel 'time (ms)'
+set title 'fast doubling time, v0 and v1 against v2'
+set term png enhanced font 'Verdana,10'
+set output 'plot_fdoubling.png'
+set grid
+set key left top
+set logscale xy
+plot \
+'plot_fdoubling' \
+using 1:2 with linespoints linewidth 2 title "v0",\
+'plot_fdoubling' \
+using 1:3 with linespoints linewidth 2 title "v1",\
+'plot_fdoubling' \
+using 1:4 with linespoints linewidth 2 title "v2"
@@ -0,0 +1,15 @@
+reset
+set xlabel 'F(n)'
+set ylabel 'time (ns)'
+set title 'fib\_read latency by output format'
+set term png enhanced font 'Verdana,10'
+set output 'plot_format.png'
+set grid
+set key left top
+plot \
+'plot_format' \
+using 1:2 with linespoints linewidth 2 title "decimal",\
+'plot_format' \
+using 1:3 with linespoints linewidth 2 title "hex",\
+'plot_format' \
+using 1:4 with linespoints linewidth 2 title "binary limbs"
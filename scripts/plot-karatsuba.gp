@@ -0,0 +1,12 @@
+reset
+set xlabel 'F(n)'
+set ylabel 'time (ns)'
+set title 'bn fdoubling v1: schoolbook vs Karatsuba'
+set term png enhanced font 'Verdana,10'
+set output 'plot_karatsuba.png'
+set grid
+plot \
+'plot_schoolbook' \
+using 1:2 with linespoints linewidth 2 title "schoolbook",\
+'plot_karatsuba' \
+using 1:2 with linespoints linewidth 2 title "karatsuba"
@@ -0,0 +1,15 @@
+reset
+set xlabel 'log2(n + 1)'
+set ylabel 'time (ns)'
+set title 'FIB\_IOC\_MOD time per call'
+set term png enhanced font 'Verdana,10'
+set output 'plot_mod.png'
+set grid
+set key left top
+plot \
+'plot_mod' \
+using 1:2 with linespoints linewidth 2 title "m = 2^{64} - 59",\
+'plot_mod' \
+using 1:3 with linespoints linewidth 2 title "m = 10^9 + 7",\
+'plot_mod' \
+using 1:4 with linespoints linewidth 2 title "m = 1000"
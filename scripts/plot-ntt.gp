@@ -0,0 +1,14 @@
+reset
+set xlabel 'F(n)'
+set ylabel 'time (ms)'
+set title 'bn\_fdoubling\_v1 time, Karatsuba against NTT'
+set term png enhanced font 'Verdana,10'
+set output 'plot_ntt.png'
+set grid
+set key left top
+set logscale xy
+plot \
+'plot_ntt' \
+using 1:2 with linespoints linewidth 2 title "Karatsuba",\
+'plot_ntt' \
+using 1:3 with linespoints linewidth 2 title "NTT"
@@ -0,0 +1,15 @@
+reset
+set xlabel 'max\_parallel (CPUs)'
+set ylabel 'speedup over one CPU'
+set title 'bn\_fdoubling\_v1 speedup by CPUs'
+set term png enhanced font 'Verdana,10'
+set output 'plot_par.png'
+set grid
+set key left top
+plot \
+'plot_par' \
+using 1:5 with linespoints linewidth 2 title "F(10^5)",\
+'plot_par' \
+using 1:6 with linespoints linewidth 2 title "F(10^6)",\
+'plot_par' \
+using 1:7 with linespoints linewidth 2 title "F(10^7)"
@@ -0,0 +1,15 @@
+reset
+set xlabel 'max\_parallel (CPUs)'
+set ylabel 'values / s'
+set y2label 'speedup over one CPU'
+set title 'FIB\_IOC\_RANGE throughput of F(0..20000) by CPUs'
+set term png enhanced font 'Verdana,10'
+set output 'plot_range.png'
+set grid
+set key left top
+set y2tics
+plot \
+'plot_range' \
+using 1:2 with linespoints linewidth 2 title "values / s",\
+'plot_range' \
+using 1:3 axes x1y2 with linespoints linewidth 2 title "speedup"
@@ -0,0 +1,13 @@
+reset
+set xlabel 'F(n)'
+set ylabel 'time (ns)'
+set title 'fib\_read latency'
+set term png enhanced font 'Verdana,10'
+set output 'plot_read_latency.png'
+set grid
+set key left top
+plot \
+'plot_read_latency' \
+using 1:2 with linespoints linewidth 2 title "bn fdoubling v1 + bn\_to\_string",\
+'plot_read_latency' \
+using 1:3 with linespoints linewidth 2 title "decimal limbs"
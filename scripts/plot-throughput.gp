@@ -0,0 +1,11 @@
+reset
+set xlabel 'threads'
+set ylabel 'reads per second'
+set title 'fib\_read aggregate throughput'
+set term png enhanced font 'Verdana,10'
+set output 'plot_throughput.png'
+set grid
+set key left top
+plot \
+'plot_throughput' \
+using 1:2 with linespoints linewidth 2 title "bn fdoubling v1, one fd per thread"
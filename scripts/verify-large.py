@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# check F(n) read from /dev/fibonacci against python for large n
+# usage: verify-large.py [mode] n...
+
+import fcntl
+import os
+import struct
+import sys
+
+FIB_DEV = '/dev/fibonacci'
+# _IOW('f', nr, __u32) from fibdrv_ioctl.h
+FIB_IOC_SET_MODE = (1 << 30) | (4 << 16) | (ord('f') << 8) | 4
+FIB_IOC_SET_FORMAT = (1 << 30) | (4 << 16) | (ord('f') << 8) | 5
+FIB_FMT_HEX = 2
+
+
+def fib(n):
+    # fast doubling, returns (F(n), F(n+1))
+    try:
+        import gmpy2
+        return gmpy2.fib2(n + 1)[::-1]
+    except ImportError:
+        pass
+    a, b = 0, 1
+    for bit in bin(n)[2:]:
+        c = a * (2 * b - a)
+        d = a * a + b * b
+        a, b = (d, c + d) if bit == '1' else (c, d)
+    return a, b
+
+
+def read_fib(fd, n):
+    os.lseek(fd, n, os.SEEK_SET)
+    chunks = []
+    while True:
+        chunk = os.read(fd, 1 << 20)
+        if not chunk:
+            break
+        chunks.append(chunk)
+    return b''.join(chunks).rstrip(b'\n').decode()
+
+
+args = [int(a) for a in sys.argv[1:]]
+mode = 2
+if len(args) > 1 and args[0] <= 5:
+    mode, args = args[0], args[1:]
+ns = args or [10 ** 6, 10 ** 7]
+
+fd = os.open(FIB_DEV, os.O_RDONLY)
+fcntl.ioctl(fd, FIB_IOC_SET_MODE, struct.pack('I', mode))
+fcntl.ioctl(fd, FIB_IOC_SET_FORMAT, struct.pack('I', FIB_FMT_HEX))
+failed = 0
+for n in ns:
+    got = read_fib(fd, n)
+    expect = format(int(fib(n)[0]), 'x')
+    if got != expect:
+        print('f(%d) fail: %d hex digits, expected %d' %
+              (n, len(got), len(expect)))
+        failed += 1
+    else:
+        print('f(%d) ok: %d hex digits' % (n, len(got)))
+os.close(fd)
+sys.exit(1 if failed else 0)
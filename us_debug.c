@@ -7,27 +7,61 @@
 #include <unistd.h>
 
 #include "bn.h"
+#include "bn_dec.h"
 #define FIB_DEV "/dev/fibonacci"
 #define offset 2000
-#define mode 0
 
 
-int main()
+/*
+ * print F(0) to F(offset) as fib_read does, by the FIB_ALGO named in the
+ * argument, "add" by default
+ */
+int main(int argc, char const *argv[])
 {
-    void (*fib_algorithm[3])(bn *, unsigned int) = {bn_fib_v1, bn_fdoubling_v0,
-                                                    bn_fdoubling_v1};
+    int mode = argc > 1 ? bn_fib_algo_find(argv[1]) : FIB_ALGO_ADD;
+    if (mode < 0 || (!bn_fib_algos[mode].fib && mode != FIB_ALGO_DEC &&
+                     mode != FIB_ALGO_CKPT)) {
+        fprintf(stderr, "usage: %s [algorithm], one of:", argv[0]);
+        for (int i = 0; i < FIB_ALGO_NR; i++) {
+            if (bn_fib_algos[i].fib || i == FIB_ALGO_DEC ||
+                i == FIB_ALGO_CKPT)
+                fprintf(stderr, " %s", bn_fib_algos[i].name);
+        }
+        fprintf(stderr, "\n");
+        return 1;
+    }
+    bn_init();
+    bn_arena *arena = bn_arena_new();
 
     for (int i = 0; i <= offset; i++) {
-        bn *fib = bn_alloc(1);
-        fib_algorithm[mode](fib, i);
-        char *buf = bn_to_string(fib);
+        bn_arena_reserve(arena, bn_fib_limbs(i));
+        bn *fib = bn_alloc_arena(arena, 1);
+        char *buf;
+        if (mode == FIB_ALGO_DEC) {
+            /* decimal limbs, as fib_read mode 3 */
+            bn_dec *dec = bn_dec_alloc(1);
+            bn_dec_fdoubling(dec, i);
+            buf = bn_dec_to_string(dec);
+            bn_dec_free(dec);
+        } else if (mode == FIB_ALGO_CKPT) {
+            /* resume from (F(k), F(k+1)), as fib_read mode 4 */
+            bn *fk = bn_alloc_arena(arena, 1);
+            bn *fk1 = bn_alloc_arena(arena, 1);
+            bn_fdoubling_pair(fk, fk1, i & ~63);
+            bn_fib_resume(fib, fk, fk1, i & 63);
+            buf = bn_to_string(fib);
+        } else {
+            bn_fib_algos[mode].fib(fib, i);
+            buf = bn_to_string(fib);
+        }
         printf("Reading from " FIB_DEV
                " at offset %d, returned the sequence "
                "%s.\n",
                i, buf);
-        bn_free(fib);
+        bn_arena_reset(arena);
         free(buf);
     }
+    bn_arena_free(arena);
 
     return 0;
 }